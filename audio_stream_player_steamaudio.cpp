@@ -135,6 +135,24 @@ int AudioStreamPlayerSteamAudio::get_max_polyphony() const {
 	return max_polyphony;
 }
 
+//Length of the reflection IR in seconds, 0 takes it from the reverb zone the player is in
+void AudioStreamPlayerSteamAudio::set_reverb_time(float p_reverb_time) {
+	reverb_time = MAX(p_reverb_time, 0.0f);
+}
+
+float AudioStreamPlayerSteamAudio::get_reverb_time() const {
+	return reverb_time;
+}
+
+//The effects are built for one type, so a change is picked up by the next play()
+void AudioStreamPlayerSteamAudio::set_reflection_type(ReflectionType p_reflection_type) {
+	reflection_type = p_reflection_type;
+}
+
+AudioStreamPlayerSteamAudio::ReflectionType AudioStreamPlayerSteamAudio::get_reflection_type() const {
+	return reflection_type;
+}
+
 void AudioStreamPlayerSteamAudio::play(float p_from_pos) {
 	if (stream.is_null()) {
 		return;
@@ -143,7 +161,7 @@ void AudioStreamPlayerSteamAudio::play(float p_from_pos) {
 	if (stream->is_monophonic() && is_playing()) {
 		stop();
 	}
-	Ref<AudioStreamPlaybackSteamAudio> stream_playback = stream->instantiate_playback();
+	Ref<AudioStreamPlaybackSteamAudio> stream_playback = stream->instantiate_playback_steamaudio(reflection_type);
 	ERR_FAIL_COND_MSG(stream_playback.is_null(), "Failed to instantiate playback.");
 
 	AudioServer::get_singleton()->start_playback_stream(stream_playback, bus, _get_volume_vector(), p_from_pos, pitch_scale);
@@ -362,6 +380,12 @@ void AudioStreamPlayerSteamAudio::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_max_polyphony", "max_polyphony"), &AudioStreamPlayerSteamAudio::set_max_polyphony);
 	ClassDB::bind_method(D_METHOD("get_max_polyphony"), &AudioStreamPlayerSteamAudio::get_max_polyphony);
 
+	ClassDB::bind_method(D_METHOD("set_reverb_time", "reverb_time"), &AudioStreamPlayerSteamAudio::set_reverb_time);
+	ClassDB::bind_method(D_METHOD("get_reverb_time"), &AudioStreamPlayerSteamAudio::get_reverb_time);
+
+	ClassDB::bind_method(D_METHOD("set_reflection_type", "reflection_type"), &AudioStreamPlayerSteamAudio::set_reflection_type);
+	ClassDB::bind_method(D_METHOD("get_reflection_type"), &AudioStreamPlayerSteamAudio::get_reflection_type);
+
 	ClassDB::bind_method(D_METHOD("has_stream_playback"), &AudioStreamPlayerSteamAudio::has_stream_playback);
 	ClassDB::bind_method(D_METHOD("get_stream_playback"), &AudioStreamPlayerSteamAudio::get_stream_playback);
 	ClassDB::bind_method(D_METHOD("init_source_steamaudio"), &AudioStreamPlayerSteamAudio::init_source_steamaudio);
@@ -374,6 +398,8 @@ void AudioStreamPlayerSteamAudio::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "stream_paused", PROPERTY_HINT_NONE, ""), "set_stream_paused", "get_stream_paused");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "mix_target", PROPERTY_HINT_ENUM, "Stereo,Surround,Center"), "set_mix_target", "get_mix_target");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_polyphony", PROPERTY_HINT_NONE, ""), "set_max_polyphony", "get_max_polyphony");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "reverb_time", PROPERTY_HINT_RANGE, "0,10,0.01,suffix:s"), "set_reverb_time", "get_reverb_time");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "reflection_type", PROPERTY_HINT_ENUM, "Default,Convolution,Parametric,Hybrid"), "set_reflection_type", "get_reflection_type");
 	ADD_PROPERTY(PropertyInfo(Variant::STRING_NAME, "bus", PROPERTY_HINT_ENUM, ""), "set_bus", "get_bus");
 
 	ADD_SIGNAL(MethodInfo("finished"));
@@ -381,6 +407,11 @@ void AudioStreamPlayerSteamAudio::_bind_methods() {
 	BIND_ENUM_CONSTANT(MIX_TARGET_STEREO);
 	BIND_ENUM_CONSTANT(MIX_TARGET_SURROUND);
 	BIND_ENUM_CONSTANT(MIX_TARGET_CENTER);
+
+	BIND_ENUM_CONSTANT(REFLECTION_TYPE_DEFAULT);
+	BIND_ENUM_CONSTANT(REFLECTION_TYPE_CONVOLUTION);
+	BIND_ENUM_CONSTANT(REFLECTION_TYPE_PARAMETRIC);
+	BIND_ENUM_CONSTANT(REFLECTION_TYPE_HYBRID);
 }
 
 AudioStreamPlayerSteamAudio::AudioStreamPlayerSteamAudio() {
@@ -48,6 +48,13 @@ public:
 		MIX_TARGET_CENTER
 	};
 
+	enum ReflectionType {
+		REFLECTION_TYPE_DEFAULT,
+		REFLECTION_TYPE_CONVOLUTION,
+		REFLECTION_TYPE_PARAMETRIC,
+		REFLECTION_TYPE_HYBRID
+	};
+
 private:
 	Vector<Ref<AudioStreamPlaybackSteamAudio>> stream_playbacks;
 	Ref<AudioStreamSteamAudio> stream;
@@ -59,6 +66,8 @@ private:
 	bool autoplay = false;
 	StringName bus = SNAME("Master");
 	int max_polyphony = 1;
+	float reverb_time = 0.0;
+	ReflectionType reflection_type = REFLECTION_TYPE_DEFAULT;
 
 	MixTarget mix_target = MIX_TARGET_STEREO;
 
@@ -92,6 +101,12 @@ public:
 	void set_max_polyphony(int p_max_polyphony);
 	int get_max_polyphony() const;
 
+	void set_reverb_time(float p_reverb_time);
+	float get_reverb_time() const;
+
+	void set_reflection_type(ReflectionType p_reflection_type);
+	ReflectionType get_reflection_type() const;
+
 	void play(float p_from_pos = 0.0);
 	void seek(float p_seconds);
 	void stop();
@@ -120,5 +135,6 @@ public:
 };
 
 VARIANT_ENUM_CAST(AudioStreamPlayerSteamAudio::MixTarget)
+VARIANT_ENUM_CAST(AudioStreamPlayerSteamAudio::ReflectionType)
 
 #endif // AUDIO_STREAM_PLAYER_STEAMAUDIO_H
@@ -31,16 +31,25 @@
 //Above notice retained as this is largely based on AudioStreamPolyphonic
 
 #include "audio_stream_steamaudio.h"
+#include "audio_stream_player_steamaudio.h"
 #include "steamaudio_server.h"
+#include "steamaudio_trace.h"
+#include "steamaudio_realtime.h"
 #include "scene/main/scene_tree.h"
 #include <unistd.h>
 
 Ref<AudioStreamPlayback> AudioStreamSteamAudio::instantiate_playback() {
+	return instantiate_playback_steamaudio(AudioStreamPlayerSteamAudio::REFLECTION_TYPE_DEFAULT);
+}
+
+//The effects are built for the player's reflection type right away, so init_source_steamaudio() doesn't rebuild them
+Ref<AudioStreamPlaybackSteamAudio> AudioStreamSteamAudio::instantiate_playback_steamaudio(int player_reflection_type) {
 	Ref<AudioStreamPlaybackSteamAudio> playback;
 	playback.instantiate();
 	playback->streams.resize(polyphony);
+        playback->local_state.reflection_type = playback->resolve_reflection_type_steamaudio(player_reflection_type);
         for (uint32_t i = 0; i < playback->streams.size(); i++) {
-            init_effect_steamaudio(*(playback->global_state),playback->streams[i].effect);
+            init_effect_steamaudio(*(playback->global_state),playback->streams[i].effect,playback->local_state.reflection_type);
         }
 	return playback;
 }
@@ -88,12 +97,15 @@ void AudioStreamPlaybackSteamAudio::stop() {
 		return;
 	}
 
+	//The driver may hold the AudioServer lock for a whole mix, which is what this site measures
+	LockTimerSteamAudio lock_timer("AudioServer: AudioStreamPlaybackSteamAudio::stop");
 	bool locked = false;
 	for (Stream &s : streams) {
-		if (s.active.is_set()) {
+		if (s.active.is_set() && !locked) {
 			// Need locking because something may still be mixing.
 			locked = true;
 			AudioServer::get_singleton()->lock();
+			lock_timer.acquired();
 		}
 		s.active.clear();
 		s.finish_request.clear();
@@ -130,13 +142,31 @@ void AudioStreamPlaybackSteamAudio::tag_used_streams() {
 	}
 }
 
+//The driver's entry point. During render_offline() the server mixes the sources itself, block by block,
+//so the driver gets silence rather than advancing the streams between those blocks
 int AudioStreamPlaybackSteamAudio::mix(AudioFrame *p_buffer, float p_rate_scale, int p_frames) {
+        if (global_state->offline_render.load(std::memory_order_acquire)) {
+            if (!active) {
+                return 0;
+            }
+            for (int i = 0; i < p_frames; i++) {
+                p_buffer[i] = AudioFrame(0, 0);
+            }
+            return p_frames;
+        }
+        return mix_sources(p_buffer, p_rate_scale, p_frames);
+}
+
+int AudioStreamPlaybackSteamAudio::mix_sources(AudioFrame *p_buffer, float p_rate_scale, int p_frames) {
 	if (!active) {
             return 0;
 	}
         if (!local_state.source.source_initialized) {
             return 0;
         }
+        AUDIO_THREAD_SCOPE_STEAMAUDIO();
+        trace_thread_name_steamaudio("audio");
+        uint64_t start_usec = ticks_usec_steamaudio();
 
 	// Pre-clear buffer.
 	for (int i = 0; i < p_frames; i++) {
@@ -144,11 +174,11 @@ int AudioStreamPlaybackSteamAudio::mix(AudioFrame *p_buffer, float p_rate_scale,
 	}
         SimOutputsSteamAudio * sim_outputs = &(local_state.sim_outputs);
 
-        //If either output is invalid, we'll skip
-        bool direct_valid = sim_outputs->direct_valid[get_read_direct_idx(sim_outputs)];
-        bool indirect_valid = sim_outputs->indirect_valid[get_read_indirect_idx(sim_outputs)];
+        //Take the newest outputs once for the whole mix, without a direct result yet we'll skip
+        bool direct_valid = sim_outputs->direct.acquire();
+        sim_outputs->indirect.acquire();
 
-        if (!direct_valid || !indirect_valid) {
+        if (!direct_valid) {
             return p_frames;
         }
 	for (Stream &s : streams) {
@@ -189,6 +219,9 @@ int AudioStreamPlaybackSteamAudio::mix(AudioFrame *p_buffer, float p_rate_scale,
 		}
 	}
 
+        //Measured against the time this block takes to play
+        uint64_t deadline_usec = (uint64_t)p_frames * 1000000 / global_state->audio_settings.samplingRate;
+        record_mix_time_steamaudio(global_state->stats, global_state->stats.mix_blocks.load(std::memory_order_relaxed), ticks_usec_steamaudio() - start_usec, deadline_usec);
 
 	return p_frames;
 }
@@ -259,20 +292,112 @@ void AudioStreamPlaybackSteamAudio::stop_stream(ID p_stream_id) {
 }
 
 bool AudioStreamPlaybackSteamAudio::init_source_steamaudio(AudioStreamPlayerSteamAudio * player) {
+    if (local_state.source.source_initialized) {
+        return true;
+    }
+    //Without its buffers the playback can't be spatialized
+    if (!local_state_initialized) {
+        return false;
+    }
     local_state.source.steamaudio_player = player;
-    IPLSourceSettings source_settings{};
-    source_settings.flags = static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT|IPL_SIMULATIONFLAGS_REFLECTIONS);
-    
-    IPLerror errorCode = iplSourceCreate(global_state->simulator, &source_settings, &(local_state.source.src));
-    if (errorCode) {
-        printf("Err code for iplSourceCreate: %d\n", errorCode);
+    local_state.source.playback = this;
+    set_reflection_type_steamaudio(player->get_reflection_type());
+    local_state.source.src = SteamAudioServer::get_singleton()->checkout_source();
+    if (local_state.source.src == nullptr) {
         return false;
-    } 
+    }
+    //Pooled sources may have served another player, start from a clean simulation state.
+    //The source isn't registered yet and mix() skips it until source_initialized, so neither side of the buffers is running
+    local_state.sim_outputs.direct.reset();
+    local_state.sim_outputs.indirect.reset();
+    local_state.sim_outputs.direct_sim_started = false;
+    local_state.sim_outputs.indirect_sim_started = false;
+    local_state.cluster = nullptr;
     SteamAudioServer::get_singleton()->add_source(&(local_state));
     local_state.source.source_initialized = true;
     return true;
 }
 
+//Maps the player's type to one the simulator produces outputs for
+IPLReflectionEffectType AudioStreamPlaybackSteamAudio::resolve_reflection_type_steamaudio(int player_reflection_type) const {
+    IPLReflectionEffectType simulator_type = global_state->sim_settings.reflectionType;
+    IPLReflectionEffectType reflection_type = simulator_type;
+    switch (player_reflection_type) {
+        case AudioStreamPlayerSteamAudio::REFLECTION_TYPE_CONVOLUTION:
+            reflection_type = IPL_REFLECTIONEFFECTTYPE_CONVOLUTION;
+            break;
+        case AudioStreamPlayerSteamAudio::REFLECTION_TYPE_PARAMETRIC:
+            reflection_type = IPL_REFLECTIONEFFECTTYPE_PARAMETRIC;
+            break;
+        case AudioStreamPlayerSteamAudio::REFLECTION_TYPE_HYBRID:
+            reflection_type = IPL_REFLECTIONEFFECTTYPE_HYBRID;
+            break;
+        default:
+            break;
+    }
+    //Only a hybrid simulator produces both the IR and the parametric reverb
+    if (reflection_type != simulator_type && simulator_type != IPL_REFLECTIONEFFECTTYPE_HYBRID) {
+        WARN_PRINT_ONCE("Per-player reflection_type needs steamaudio/simulation/reflection_type set to Hybrid, using the project setting.");
+        reflection_type = simulator_type;
+    }
+    return reflection_type;
+}
+
+//Rebuilds the effects when the player asks for another reflection type than they were created with.
+//mix() may still be running the old ones, so the new effects are built first and swapped in under the AudioServer lock
+void AudioStreamPlaybackSteamAudio::set_reflection_type_steamaudio(int player_reflection_type) {
+    IPLReflectionEffectType reflection_type = resolve_reflection_type_steamaudio(player_reflection_type);
+    if (reflection_type == local_state.reflection_type) {
+        return;
+    }
+    LocalVector<EffectSteamAudio> effects;
+    effects.resize(streams.size());
+    for (uint32_t i = 0; i < effects.size(); i++) {
+        int error_code = init_effect_steamaudio(*global_state, effects[i], reflection_type);
+        if (error_code) {
+            //The player keeps the effects and type it has
+            printf("Err code for init_effect_steamaudio: %d\n", error_code);
+            for (uint32_t j = 0; j < i; j++) {
+                deinit_effect_steamaudio(*global_state, effects[j]);
+            }
+            return;
+        }
+    }
+    {
+        LockTimerSteamAudio lock_timer("AudioServer: AudioStreamPlaybackSteamAudio::set_reflection_type_steamaudio");
+        AudioServer::get_singleton()->lock();
+        lock_timer.acquired();
+        for (uint32_t i = 0; i < streams.size(); i++) {
+            SWAP(streams[i].effect, effects[i]);
+        }
+        local_state.reflection_type = reflection_type;
+        AudioServer::get_singleton()->unlock();
+    }
+    for (EffectSteamAudio& effect : effects) {
+        deinit_effect_steamaudio(*global_state, effect);
+    }
+}
+
+IPLReflectionEffectType AudioStreamPlaybackSteamAudio::get_reflection_type() const {
+    return local_state.reflection_type;
+}
+
+int AudioStreamPlaybackSteamAudio::get_num_effects() const {
+    return streams.size();
+}
+
+//Caller holds the AudioServer lock, resources needs one effect per stream
+void AudioStreamPlaybackSteamAudio::swap_quality_resources(QualityResourcesSteamAudio& resources) {
+    ERR_FAIL_COND(resources.effects.size() != streams.size());
+    SWAP(local_state.ambisonics_buffer, resources.ambisonics_buffer);
+    SWAP(local_state.refl_buffer, resources.refl_buffer);
+    for (uint32_t i = 0; i < streams.size(); i++) {
+        SWAP(streams[i].effect, resources.effects[i]);
+        //The new effect picks up the IR length where the old one left off
+        streams[i].effect.ir_size = resources.effects[i].ir_size;
+    }
+}
+
 void AudioStreamPlaybackSteamAudio::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("play_stream", "stream", "from_offset", "volume_db", "pitch_scale"), &AudioStreamPlaybackSteamAudio::play_stream, DEFVAL(0), DEFVAL(0), DEFVAL(1.0));
 	ClassDB::bind_method(D_METHOD("set_stream_volume", "stream", "volume_db"), &AudioStreamPlaybackSteamAudio::set_stream_volume);
@@ -284,13 +409,20 @@ void AudioStreamPlaybackSteamAudio::_bind_methods() {
 
 AudioStreamPlaybackSteamAudio::AudioStreamPlaybackSteamAudio() {
     global_state = SteamAudioServer::get_singleton()->clone_global_state();
-    init_local_state_steamaudio(*global_state,local_state);
+    int error_code = init_local_state_steamaudio(*global_state,local_state);
+    if (error_code) {
+        printf("Err code for init_local_state_steamaudio: %d\n", error_code);
+    }
+    local_state_initialized = error_code == 0;
+    SteamAudioServer::get_singleton()->register_playback(this);
 }
 
 AudioStreamPlaybackSteamAudio::~AudioStreamPlaybackSteamAudio() {
     SteamAudioServer::get_singleton()->remove_source(&(local_state));
+    SteamAudioServer::get_singleton()->deregister_playback(this);
     for (uint32_t i = 0; i < streams.size(); i++) {
             deinit_effect_steamaudio(*global_state,streams[i].effect);
     }
+    //Safe after a failed init too, the buffers it freed were cleared
     deinit_local_state_steamaudio(*global_state,local_state);
 }
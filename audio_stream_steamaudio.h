@@ -45,6 +45,7 @@ class AudioStreamSteamAudio : public AudioStream {
 
 public:
 	virtual Ref<AudioStreamPlayback> instantiate_playback() override;
+	Ref<AudioStreamPlaybackSteamAudio> instantiate_playback_steamaudio(int player_reflection_type);
 	virtual String get_stream_name() const override;
 	virtual bool is_monophonic() const override;
 
@@ -84,6 +85,7 @@ protected:
 
         GlobalStateSteamAudio* global_state;
         LocalStateSteamAudio local_state;
+        bool local_state_initialized = false;
 	LocalVector<Stream> streams;
 	bool active = false;
 	uint32_t id_counter = 1;
@@ -109,6 +111,7 @@ public:
 	virtual void tag_used_streams() override;
 
 	virtual int mix(AudioFrame *p_buffer, float p_rate_scale, int p_frames) override;
+	int mix_sources(AudioFrame *p_buffer, float p_rate_scale, int p_frames);
 
 	ID play_stream(const Ref<AudioStream> &p_stream, float p_from_offset = 0, float p_volume_db = 0, float p_pitch_scale = 1.0);
 	void set_stream_volume(ID p_stream_id, float p_volume_db);
@@ -117,6 +120,11 @@ public:
 	void stop_stream(ID p_stream_id);
 
         bool init_source_steamaudio(AudioStreamPlayerSteamAudio * player);
+        IPLReflectionEffectType resolve_reflection_type_steamaudio(int player_reflection_type) const;
+        void set_reflection_type_steamaudio(int player_reflection_type);
+        IPLReflectionEffectType get_reflection_type() const;
+        int get_num_effects() const;
+        void swap_quality_resources(QualityResourcesSteamAudio& resources);
 
 
 	AudioStreamPlaybackSteamAudio();
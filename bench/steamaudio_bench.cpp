@@ -0,0 +1,368 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+//Headless benchmark of the spatialization pipeline, built with "scons steamaudio_bench=yes".
+//Links the module sources that don't need the scene tree or project settings, plus Godot's core library, results are printed as JSON.
+//
+//  steamaudio_bench [--sources=1,8,32,128] [--orders=1,2,3] [--frame-sizes=256,512,1024]
+//                   [--blocks=256] [--rays=1024] [--subdivisions=8] [--mix-rate=48000] [--output=path]
+
+#include "../godot_steamaudio.h"
+#include "../steamaudio_benchmark.h"
+#include "../steamaudio_memory.h"
+#include "core/math/math_funcs.h"
+#include "core/templates/local_vector.h"
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SOURCE_RING_RADIUS_STEAMAUDIO 6.0f
+#define BENCH_SIM_ITERATIONS_STEAMAUDIO 3
+
+struct BenchConfigSteamAudio {
+    LocalVector<int> source_counts;
+    LocalVector<int> orders;
+    LocalVector<int> frame_sizes;
+    int blocks = 256;
+    int num_rays = 1024;
+    int subdivisions = 8;
+    int mix_rate = 48000;
+    const char * output_path = nullptr;
+};
+
+static uint64_t ticks_nsec_bench_steamaudio() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool parse_int_list_bench_steamaudio(const char * arg, LocalVector<int>& values) {
+    values.clear();
+    const char * cursor = arg;
+    while (*cursor) {
+        char * end = nullptr;
+        long value = strtol(cursor, &end, 10);
+        if (end == cursor || value <= 0) {
+            return false;
+        }
+        values.push_back((int)value);
+        cursor = (*end == ',') ? end + 1 : end;
+    }
+    return !values.is_empty();
+}
+
+static bool parse_args_bench_steamaudio(int argc, char ** argv, BenchConfigSteamAudio& config) {
+    for (int aidx = 1; aidx < argc; aidx++) {
+        const char * arg = argv[aidx];
+        const char * value = strchr(arg, '=');
+        if (value == nullptr) {
+            return false;
+        }
+        value++;
+        bool ok = true;
+        if (strncmp(arg, "--sources=", 10) == 0) {
+            ok = parse_int_list_bench_steamaudio(value, config.source_counts);
+        } else if (strncmp(arg, "--orders=", 9) == 0) {
+            ok = parse_int_list_bench_steamaudio(value, config.orders);
+        } else if (strncmp(arg, "--frame-sizes=", 14) == 0) {
+            ok = parse_int_list_bench_steamaudio(value, config.frame_sizes);
+        } else if (strncmp(arg, "--blocks=", 9) == 0) {
+            config.blocks = atoi(value);
+        } else if (strncmp(arg, "--rays=", 7) == 0) {
+            config.num_rays = atoi(value);
+        } else if (strncmp(arg, "--subdivisions=", 15) == 0) {
+            config.subdivisions = atoi(value);
+        } else if (strncmp(arg, "--mix-rate=", 11) == 0) {
+            config.mix_rate = atoi(value);
+        } else if (strncmp(arg, "--output=", 9) == 0) {
+            config.output_path = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return config.blocks > 0 && config.num_rays > 0 && config.mix_rate > 0;
+}
+
+//Simulates num_sources sources in the benchmark room once, then times spatialize_steamaudio() on their outputs.
+//requested_sources is what was asked for on the command line, it is larger when the simulator's source limit capped it
+static int bench_sources_steamaudio(GlobalStateSteamAudio& global_state, const BenchConfigSteamAudio& config, int num_sources, int requested_sources, FILE * out, bool& first) {
+    LocalVector<LocalStateSteamAudio*> local_states;
+    LocalVector<EffectSteamAudio*> effects;
+    LocalVector<IPLSource> sources;
+    int64_t bytes_before = get_total_memory_bytes_steamaudio(get_live_memory_ledger_steamaudio());
+    int error_code = 0;
+
+    IPLCoordinateSpace3 listener{};
+    listener.ahead = IPLVector3{0.0f, 0.0f, -1.0f};
+    listener.up = IPLVector3{0.0f, 1.0f, 0.0f};
+    listener.right = IPLVector3{1.0f, 0.0f, 0.0f};
+    listener.origin = IPLVector3{0.0f, 1.7f, 0.0f};
+
+    //States and effects are only kept once they initialized, the init functions free their own partial work
+    for (int sidx = 0; sidx < num_sources; sidx++) {
+        LocalStateSteamAudio * local_state = memnew(LocalStateSteamAudio);
+        error_code = init_local_state_steamaudio(global_state, *local_state);
+        if (error_code) {
+            memdelete(local_state);
+            break;
+        }
+        local_states.push_back(local_state);
+        EffectSteamAudio * effect = memnew(EffectSteamAudio);
+        error_code = init_effect_steamaudio(global_state, *effect, global_state.sim_settings.reflectionType);
+        if (error_code) {
+            memdelete(effect);
+            break;
+        }
+        effects.push_back(effect);
+        IPLSource src = nullptr;
+        IPLSourceSettings source_settings{};
+        source_settings.flags = static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT | IPL_SIMULATIONFLAGS_REFLECTIONS);
+        error_code = iplSourceCreate(global_state.simulator, &source_settings, &src);
+        if (error_code) {
+            printf("Err code for iplSourceCreate: %d\n", error_code);
+            break;
+        }
+        sources.push_back(src);
+        iplSourceAdd(src, global_state.simulator);
+
+        float angle = Math_TAU * sidx / num_sources;
+        IPLSimulationInputs inputs{};
+        inputs.flags = static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT | IPL_SIMULATIONFLAGS_REFLECTIONS);
+        inputs.directFlags = static_cast<IPLDirectSimulationFlags>(IPL_DIRECTSIMULATIONFLAGS_OCCLUSION | IPL_DIRECTSIMULATIONFLAGS_TRANSMISSION);
+        inputs.source.origin = IPLVector3{BENCH_SOURCE_RING_RADIUS_STEAMAUDIO * cosf(angle), 1.5f, BENCH_SOURCE_RING_RADIUS_STEAMAUDIO * sinf(angle)};
+        inputs.occlusionType = IPL_OCCLUSIONTYPE_VOLUMETRIC;
+        inputs.occlusionRadius = local_state->setting_occlusion_radius;
+        inputs.numOcclusionSamples = local_state->setting_occlusion_num_samples;
+        set_reflection_inputs_steamaudio(global_state, inputs);
+        iplSourceSetInputs(src, static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT | IPL_SIMULATIONFLAGS_REFLECTIONS), &inputs);
+        local_state->source_coordinates_cache = inputs.source;
+        IPLDistanceAttenuationModel distance_attenuation_model{};
+        distance_attenuation_model.type = IPL_DISTANCEATTENUATIONTYPE_DEFAULT;
+        local_state->distance_attenuation_cache = iplDistanceAttenuationCalculate(global_state.phonon_ctx, inputs.source.origin, listener.origin, &distance_attenuation_model);
+        local_state->ambisonics_direction_cache = IPLVec3toGDVec3(inputs.source.origin) - IPLVec3toGDVec3(listener.origin);
+    }
+    int64_t bytes_per_source = (get_total_memory_bytes_steamaudio(get_live_memory_ledger_steamaudio()) - bytes_before) / num_sources;
+
+    double direct_msec = 0.0;
+    double reflections_msec = 0.0;
+    if (error_code == 0) {
+        iplSimulatorCommit(global_state.simulator);
+
+        //What one tick() worth of simulation costs for this many sources
+        IPLSimulationSharedInputs shared_inputs{};
+        shared_inputs.listener = listener;
+        iplSimulatorSetSharedInputs(global_state.simulator, IPL_SIMULATIONFLAGS_DIRECT, &shared_inputs);
+        iplSimulatorRunDirect(global_state.simulator);
+        uint64_t start_nsec = ticks_nsec_bench_steamaudio();
+        for (int iter = 0; iter < BENCH_SIM_ITERATIONS_STEAMAUDIO; iter++) {
+            iplSimulatorRunDirect(global_state.simulator);
+        }
+        direct_msec = (ticks_nsec_bench_steamaudio() - start_nsec) / 1000000.0 / BENCH_SIM_ITERATIONS_STEAMAUDIO;
+
+        shared_inputs.numRays = global_state.sim_settings.maxNumRays;
+        shared_inputs.numBounces = global_state.num_bounces;
+        shared_inputs.duration = global_state.sim_settings.maxDuration;
+        shared_inputs.order = global_state.sim_settings.maxOrder;
+        shared_inputs.irradianceMinDistance = 1.0f;
+        iplSimulatorSetSharedInputs(global_state.simulator, IPL_SIMULATIONFLAGS_REFLECTIONS, &shared_inputs);
+        iplSimulatorRunReflections(global_state.simulator);
+        start_nsec = ticks_nsec_bench_steamaudio();
+        for (int iter = 0; iter < BENCH_SIM_ITERATIONS_STEAMAUDIO; iter++) {
+            iplSimulatorRunReflections(global_state.simulator);
+        }
+        reflections_msec = (ticks_nsec_bench_steamaudio() - start_nsec) / 1000000.0 / BENCH_SIM_ITERATIONS_STEAMAUDIO;
+
+        for (uint32_t sidx = 0; sidx < local_states.size(); sidx++) {
+            LocalStateSteamAudio * local_state = local_states[sidx];
+            DirectOutputsSteamAudio& direct_outputs = local_state->sim_outputs.direct.write_slot();
+            direct_outputs.distance_attenuation = local_state->distance_attenuation_cache;
+            direct_outputs.listener_orientation = listener;
+            direct_outputs.listener_orientation.origin = IPLVector3{0.0f, 0.0f, 0.0f};
+            direct_outputs.ambisonics_direction = GDVec3toIPLVec3(local_state->ambisonics_direction_cache.normalized());
+            iplSourceGetOutputs(sources[sidx], IPL_SIMULATIONFLAGS_DIRECT, &(direct_outputs.direct_sim_outputs));
+            local_state->sim_outputs.direct.publish(ticks_usec_steamaudio());
+            IndirectOutputsSteamAudio& indirect_outputs = local_state->sim_outputs.indirect.write_slot();
+            iplSourceGetOutputs(sources[sidx], IPL_SIMULATIONFLAGS_REFLECTIONS, &(indirect_outputs.indirect_sim_outputs));
+            local_state->sim_outputs.indirect.publish(ticks_usec_steamaudio());
+            local_state->sim_outputs.direct.acquire();
+            local_state->sim_outputs.indirect.acquire();
+        }
+
+        //Every source spatializes every block, like a mix() with all voices active
+        LocalVector<uint64_t> block_nsec;
+        block_nsec.resize(config.blocks * num_sources);
+        uint32_t noise = 22222;
+        for (int block = 0; block < config.blocks; block++) {
+            for (int sidx = 0; sidx < num_sources; sidx++) {
+                LocalStateSteamAudio * local_state = local_states[sidx];
+                for (unsigned int frame = 0; frame < global_state.buffer_size; frame++) {
+                    noise = noise * 1664525u + 1013904223u;
+                    float sample = (noise >> 8) / 8388608.0f - 1.0f;
+                    local_state->work_buffer[frame] = AudioFrame(sample, sample);
+                }
+                uint64_t start_nsec = ticks_nsec_bench_steamaudio();
+                spatialize_steamaudio(global_state, *local_state, *effects[sidx]);
+                block_nsec[block * num_sources + sidx] = ticks_nsec_bench_steamaudio() - start_nsec;
+            }
+        }
+        uint64_t sum_nsec = 0;
+        for (uint64_t nsec : block_nsec) {
+            sum_nsec += nsec;
+        }
+        block_nsec.sort();
+        double avg_nsec = (double)sum_nsec / block_nsec.size();
+        uint64_t p99_nsec = block_nsec[MIN((uint32_t)(block_nsec.size() * 0.99), block_nsec.size() - 1)];
+        double block_duration_nsec = global_state.buffer_size * 1000000000.0 / global_state.audio_settings.samplingRate;
+
+        fprintf(out, "%s    {\"order\": %d, \"frame_size\": %u, \"sources\": %d, \"requested_sources\": %d, \"spatialize_ns_per_block\": %.1f, \"spatialize_p99_ns_per_block\": %llu, "
+                     "\"mix_cpu_fraction\": %.4f, \"direct_sim_msec\": %.3f, \"reflections_msec\": %.3f, \"memory_bytes_per_source\": %lld}",
+                first ? "" : ",\n", global_state.sim_settings.maxOrder, global_state.buffer_size, num_sources, requested_sources, avg_nsec, (unsigned long long)p99_nsec,
+                avg_nsec * num_sources / block_duration_nsec, direct_msec, reflections_msec, (long long)bytes_per_source);
+        first = false;
+    }
+
+    for (IPLSource src : sources) {
+        iplSourceRemove(src, global_state.simulator);
+        iplSourceRelease(&src);
+    }
+    iplSimulatorCommit(global_state.simulator);
+    for (EffectSteamAudio * effect : effects) {
+        deinit_effect_steamaudio(global_state, *effect);
+        memdelete(effect);
+    }
+    for (LocalStateSteamAudio * local_state : local_states) {
+        deinit_local_state_steamaudio(global_state, *local_state);
+        memdelete(local_state);
+    }
+    return error_code;
+}
+
+//One global state per order and frame size, since both are fixed when the simulator and effects are created
+static int bench_case_steamaudio(const BenchConfigSteamAudio& config, int order, int frame_size, FILE * out, bool& first) {
+    GlobalStateSteamAudio global_state;
+    default_global_settings_steamaudio(global_state, config.mix_rate, frame_size);
+    global_state.raytracer = RAYTRACER_DEFAULT_STEAMAUDIO;
+    global_state.scene_settings.type = IPL_SCENETYPE_DEFAULT;
+    global_state.sim_settings.maxOrder = order;
+    global_state.sim_settings.maxNumRays = config.num_rays;
+    global_state.sim_settings.numThreads = MAX(1u, std::thread::hardware_concurrency());
+    global_state.pose_extrapolation.store(false);
+    //Releases its own partial state on failure
+    int error_code = create_global_state_steamaudio(global_state);
+    if (error_code) {
+        return error_code;
+    }
+
+    MeshDataSteamAudio mesh_data;
+    build_benchmark_mesh_steamaudio(config.subdivisions, mesh_data);
+    IPLStaticMeshSettings static_mesh_settings{};
+    static_mesh_settings.numVertices = mesh_data.verts.size();
+    static_mesh_settings.numTriangles = mesh_data.triangles.size();
+    static_mesh_settings.numMaterials = 1;
+    static_mesh_settings.vertices = mesh_data.verts.ptrw();
+    static_mesh_settings.triangles = mesh_data.triangles.ptrw();
+    static_mesh_settings.materialIndices = mesh_data.material_indices.ptrw();
+    static_mesh_settings.materials = default_ipl_material_steamaudio();
+    IPLStaticMesh static_mesh = nullptr;
+    error_code = iplStaticMeshCreate(global_state.scene, &static_mesh_settings, &static_mesh);
+    if (error_code) {
+        printf("Err code for iplStaticMeshCreate: %d\n", error_code);
+        deinit_global_state_steamaudio(global_state);
+        iplEmbreeDeviceRelease(&(global_state.embree_device));
+        return error_code;
+    }
+    iplStaticMeshAdd(static_mesh, global_state.scene);
+    iplSceneCommit(global_state.scene);
+    iplSimulatorSetScene(global_state.simulator, global_state.scene);
+    iplSimulatorCommit(global_state.simulator);
+
+    for (int requested_sources : config.source_counts) {
+        int num_sources = MIN(requested_sources, global_state.sim_settings.maxNumSources);
+        if (num_sources < requested_sources) {
+            fprintf(stderr, "Requested %d sources, the simulator allows %d, benchmarking %d\n", requested_sources, global_state.sim_settings.maxNumSources, num_sources);
+        }
+        error_code = bench_sources_steamaudio(global_state, config, num_sources, requested_sources, out, first);
+        if (error_code) {
+            break;
+        }
+    }
+
+    iplStaticMeshRemove(static_mesh, global_state.scene);
+    iplStaticMeshRelease(&static_mesh);
+    deinit_global_state_steamaudio(global_state);
+    iplEmbreeDeviceRelease(&(global_state.embree_device));
+    return error_code;
+}
+
+int main(int argc, char ** argv) {
+    BenchConfigSteamAudio config;
+    if (!parse_args_bench_steamaudio(argc, argv, config)) {
+        fprintf(stderr, "usage: %s [--sources=1,8,32,128] [--orders=1,2,3] [--frame-sizes=256,512,1024] [--blocks=256] [--rays=1024] [--subdivisions=8] [--mix-rate=48000] [--output=path]\n", argv[0]);
+        return 2;
+    }
+    if (config.source_counts.is_empty()) {
+        config.source_counts = { 1, 8, 32, 128 };
+    }
+    if (config.orders.is_empty()) {
+        config.orders = { 1, 2, 3 };
+    }
+    if (config.frame_sizes.is_empty()) {
+        config.frame_sizes = { 256, 512, 1024 };
+    }
+
+    FILE * out = stdout;
+    if (config.output_path) {
+        out = fopen(config.output_path, "w");
+        if (out == nullptr) {
+            fprintf(stderr, "Could not open %s\n", config.output_path);
+            return 1;
+        }
+    }
+
+    fprintf(out, "{\n  \"mix_rate\": %d, \"rays\": %d, \"blocks\": %d, \"threads\": %u,\n  \"results\": [\n",
+            config.mix_rate, config.num_rays, config.blocks, MAX(1u, std::thread::hardware_concurrency()));
+    bool first = true;
+    int error_code = 0;
+    for (int order : config.orders) {
+        for (int frame_size : config.frame_sizes) {
+            error_code = bench_case_steamaudio(config, order, frame_size, out, first);
+            if (error_code) {
+                fprintf(stderr, "Benchmark failed for order %d frame size %d: %d\n", order, frame_size, error_code);
+                break;
+            }
+        }
+        if (error_code) {
+            break;
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return error_code ? 1 : 0;
+}
@@ -6,3 +6,9 @@ def can_build(env, platform):
 def configure(env):
     pass
 
+def get_opts(platform):
+    from SCons.Variables import BoolVariable
+
+    return [
+        BoolVariable("steamaudio_bench", "Build the headless steamaudio_bench program", False),
+    ]
@@ -28,7 +28,8 @@ SOFTWARE.
 #include "core/math/math_funcs.h"
 #include "core/string/print_string.h"
 #include "core/typedefs.h"
-#include "core/config/project_settings.h"
+#include "steamaudio_trace.h"
+#include "steamaudio_memory.h"
 #include <stdio.h>
 
 #define N_CHANNELS_INOUT 2
@@ -40,103 +41,279 @@ int spatialize_steamaudio(GlobalStateSteamAudio& global_state,
     if (local_state.work_buffer==nullptr) {
         return 0;
     }
+    TRACE_SCOPE_STEAMAUDIO("spatialize");
+    uint64_t start_usec = ticks_usec_steamaudio();
 
     SimOutputsSteamAudio * sim_outputs = &(local_state.sim_outputs);
 
-    bool direct_valid = sim_outputs->direct_valid[get_read_direct_idx(sim_outputs)].load();
-    bool indirect_valid = sim_outputs->indirect_valid[get_read_indirect_idx(sim_outputs)].load();
-
-    if (!direct_valid || !indirect_valid) {
+    //Buffers were acquired once for this mix by the caller. Reflections are left out until a pass has
+    //been published, which happens at startup and after a quality change
+    if (!sim_outputs->direct.has_value()) {
         return 0;
     }
+    const DirectOutputsSteamAudio& direct_outputs = sim_outputs->direct.read();
 
 
     iplAudioBufferDeinterleave(global_state.phonon_ctx,(float *)local_state.work_buffer, &(local_state.in_buffer));
     iplAudioBufferDownmix(global_state.phonon_ctx, &(local_state.in_buffer), &(local_state.mono_buffer));
     
     //Apply direct effect
-    IPLDirectEffectParams direct_effect_params = sim_outputs->direct_outputs[get_read_direct_idx(sim_outputs)].direct_sim_outputs.direct;
+    IPLDirectEffectParams direct_effect_params = direct_outputs.direct_sim_outputs.direct;
 
     direct_effect_params.flags = static_cast<IPLDirectEffectFlags>(direct_effect_params.flags | IPL_DIRECTEFFECTFLAGS_APPLYDISTANCEATTENUATION);
     direct_effect_params.flags = static_cast<IPLDirectEffectFlags>(direct_effect_params.flags | IPL_DIRECTEFFECTFLAGS_APPLYOCCLUSION);
     direct_effect_params.flags = static_cast<IPLDirectEffectFlags>(direct_effect_params.flags | IPL_DIRECTEFFECTFLAGS_APPLYTRANSMISSION);
 
-    direct_effect_params.distanceAttenuation = sim_outputs->direct_outputs[get_read_direct_idx(sim_outputs)].distance_attenuation;
+    direct_effect_params.distanceAttenuation = direct_outputs.distance_attenuation;
     iplDirectEffectApply(effect.direct_effect, &direct_effect_params, &(local_state.in_buffer), &(local_state.direct_buffer));
 
     //Apply binaural effect
+    IPLCoordinateSpace3 listener_orientation = direct_outputs.listener_orientation;
+    IPLVector3 ambisonics_direction = direct_outputs.ambisonics_direction;
+    if (global_state.pose_extrapolation.load(std::memory_order_relaxed)) {
+        //Carry listener and source poses forward to when this block reaches the speakers
+        uint64_t block_usec = (uint64_t)global_state.buffer_size * 1000000 / global_state.audio_settings.samplingRate;
+        uint64_t output_usec = ticks_usec_steamaudio() + global_state.output_latency_usec + block_usec;
+        PoseSampleSteamAudio listener_newest, listener_previous, source_newest, source_previous;
+        if (global_state.listener_poses.read_latest(listener_newest, listener_previous)) {
+            IPLCoordinateSpace3 listener_pose = extrapolate_pose_steamaudio(listener_previous, listener_newest, output_usec, global_state.max_extrapolation_usec);
+            listener_orientation = listener_pose;
+            listener_orientation.origin = IPLVector3{0.0f,0.0f,0.0f};
+            if (local_state.source_poses.read_latest(source_newest, source_previous)) {
+                IPLCoordinateSpace3 source_pose = extrapolate_pose_steamaudio(source_previous, source_newest, output_usec, global_state.max_extrapolation_usec);
+                Vector3 direction = IPLVec3toGDVec3(source_pose.origin) - IPLVec3toGDVec3(listener_pose.origin);
+                if (!direction.is_zero_approx()) {
+                    ambisonics_direction = GDVec3toIPLVec3(direction.normalized());
+                }
+            }
+        }
+    }
+
     IPLAmbisonicsEncodeEffectParams ambisonics_enc_effect_params{};
     ambisonics_enc_effect_params.order = global_state.sim_settings.maxOrder;
-    ambisonics_enc_effect_params.direction = sim_outputs->direct_outputs[get_read_direct_idx(sim_outputs)].ambisonics_direction;
+    ambisonics_enc_effect_params.direction = ambisonics_direction;
     iplAmbisonicsEncodeEffectApply(effect.ambisonics_enc_effect, &ambisonics_enc_effect_params, &(local_state.direct_buffer), &(local_state.ambisonics_buffer));
 
     IPLAmbisonicsDecodeEffectParams ambisonics_dec_effect_params{};
     ambisonics_dec_effect_params.order = global_state.sim_settings.maxOrder;
     ambisonics_dec_effect_params.hrtf = global_state.hrtf;
-    ambisonics_dec_effect_params.orientation = sim_outputs->direct_outputs[get_read_direct_idx(sim_outputs)].listener_orientation;
+    ambisonics_dec_effect_params.orientation = listener_orientation;
     ambisonics_dec_effect_params.binaural = IPL_TRUE;
     iplAmbisonicsDecodeEffectApply(effect.ambisonics_dec_effect, &ambisonics_dec_effect_params, &(local_state.ambisonics_buffer), &(local_state.out_buffer)); 
 
     //Apply reflections and/or pathing
-    IPLReflectionEffectParams refl_effect_params = sim_outputs->indirect_outputs[get_read_indirect_idx(sim_outputs)].indirect_sim_outputs.reflections;
-    refl_effect_params.type = global_state.sim_settings.reflectionType; 
-    refl_effect_params.numChannels = num_channels_for_order(global_state.sim_settings.maxOrder);
-    refl_effect_params.irSize = num_samps_for_duration(global_state.sim_settings.maxDuration, global_state.audio_settings.samplingRate);
-    iplReflectionEffectApply(effect.refl_effect, &refl_effect_params, &(local_state.mono_buffer), &(local_state.refl_buffer), nullptr);
-    iplAmbisonicsDecodeEffectApply(effect.indirect_ambisonics_dec_effect, &ambisonics_dec_effect_params, &(local_state.refl_buffer), &(local_state.spat_buffer));
-    
-
+    if (sim_outputs->indirect.has_value()) {
+        const IndirectOutputsSteamAudio& indirect_outputs = sim_outputs->indirect.read();
+        IPLReflectionEffectParams refl_effect_params = indirect_outputs.indirect_sim_outputs.reflections;
+        refl_effect_params.type = effect.refl_settings.type;
+        refl_effect_params.numChannels = num_channels_for_order(global_state.sim_settings.maxOrder);
+        //Convolution cost is linear in the IR length, so only process as much of it as the room needs
+        float ir_duration = local_state.setting_ir_duration.load(std::memory_order_relaxed);
+        if (ir_duration <= 0.0f) {
+            //Steam Audio only estimates reverb times for parametric and hybrid reflections, otherwise these are 0
+            ir_duration = MAX(refl_effect_params.reverbTimes[0], MAX(refl_effect_params.reverbTimes[1], refl_effect_params.reverbTimes[2]));
+        }
+        int max_ir_size = num_samps_for_duration(global_state.sim_settings.maxDuration, global_state.audio_settings.samplingRate);
+        if (effect.refl_settings.type == IPL_REFLECTIONEFFECTTYPE_HYBRID) {
+            //Past the transition time the parametric tail takes over
+            max_ir_size = MIN(max_ir_size, num_samps_for_duration(global_state.hybrid_transition_time, global_state.audio_settings.samplingRate));
+        }
+        float target_ir_size = ir_duration > 0.0f ? CLAMP(num_samps_for_duration(ir_duration, global_state.audio_settings.samplingRate), 1, max_ir_size) : max_ir_size;
+        //Glide towards the new length instead of jumping to it. Each block then only adds or drops a short slice
+        //of the tail, which has mostly decayed by that point, so the change crossfades in over IR_GLIDE_TIME_STEAMAUDIO
+        if (effect.ir_size <= 0.0f) {
+            effect.ir_size = target_ir_size;
+        } else {
+            float max_step = (float)max_ir_size * global_state.buffer_size / (IR_GLIDE_TIME_STEAMAUDIO * global_state.audio_settings.samplingRate);
+            effect.ir_size = MIN(effect.ir_size + CLAMP(target_ir_size - effect.ir_size, -max_step, max_step), (float)max_ir_size);
+        }
+        refl_effect_params.irSize = MAX((int)effect.ir_size, 1);
+        iplReflectionEffectApply(effect.refl_effect, &refl_effect_params, &(local_state.mono_buffer), &(local_state.refl_buffer), nullptr);
+        iplAmbisonicsDecodeEffectApply(effect.indirect_ambisonics_dec_effect, &ambisonics_dec_effect_params, &(local_state.refl_buffer), &(local_state.spat_buffer));
 
-    //Mix
-    iplAudioBufferMix(global_state.phonon_ctx, &(local_state.spat_buffer), &(local_state.out_buffer));
+        //Mix
+        iplAudioBufferMix(global_state.phonon_ctx, &(local_state.spat_buffer), &(local_state.out_buffer));
+    }
 
 
     iplAudioBufferInterleave(global_state.phonon_ctx, &(local_state.out_buffer), (float *)local_state.work_buffer);
 
-    sim_outputs->direct_read_done.store(true);
-    sim_outputs->indirect_read_done.store(true);
+    uint64_t end_usec = ticks_usec_steamaudio();
+    local_state.last_spatialize_usec.store(end_usec, std::memory_order_relaxed);
+    record_spatialize_time_steamaudio(global_state.stats, end_usec - start_usec);
 
     return 0;
 }
 
-int init_global_state_steamaudio(GlobalStateSteamAudio& global_state) {
+//Lock-free, called from the audio thread once per spatialized block
+void record_spatialize_time_steamaudio(StatsSteamAudio& stats, uint64_t usec) {
+    uint64_t bucket = MIN(usec / SPATIALIZE_HISTOGRAM_BUCKET_USEC_STEAMAUDIO, (uint64_t)(SPATIALIZE_HISTOGRAM_BUCKETS_STEAMAUDIO - 1));
+    stats.spatialize_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    stats.spatialize_sum_usec.fetch_add(usec, std::memory_order_relaxed);
+    uint64_t min_usec = stats.spatialize_min_usec.load(std::memory_order_relaxed);
+    while (usec < min_usec && !stats.spatialize_min_usec.compare_exchange_weak(min_usec, usec, std::memory_order_relaxed)) {
+    }
+}
+
+//Players are mixed one after another on the audio thread, so a block overruns when their summed time
+//exceeds the block's duration, not when one of them does. mix_step tells the blocks apart, it is
+//StatsSteamAudio::mix_blocks so render_offline() blocks are told apart as well as the driver's
+void record_mix_time_steamaudio(StatsSteamAudio& stats, uint64_t mix_step, uint64_t usec, uint64_t deadline_usec) {
+    static thread_local uint64_t current_step = UINT64_MAX;
+    static thread_local uint64_t step_usec = 0;
+    if (mix_step != current_step) {
+        current_step = mix_step;
+        step_usec = 0;
+    }
+    uint64_t previous_usec = step_usec;
+    step_usec += usec;
+    if (previous_usec <= deadline_usec && step_usec > deadline_usec) {
+        stats.mix_overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    uint64_t max_usec = stats.mix_max_usec.load(std::memory_order_relaxed);
+    while (step_usec > max_usec && !stats.mix_max_usec.compare_exchange_weak(max_usec, step_usec, std::memory_order_relaxed)) {
+    }
+}
+
+//Engine-independent defaults, load_global_settings_steamaudio() overrides them from the project settings
+void default_global_settings_steamaudio(GlobalStateSteamAudio& global_state, float mix_rate, unsigned int buffer_size) {
     global_state.phonon_ctx_settings.version = STEAMAUDIO_VERSION;
+    global_state.phonon_ctx_settings.allocateCallback = allocate_steamaudio;
+    global_state.phonon_ctx_settings.freeCallback = free_steamaudio;
+    global_state.buffer_size = buffer_size;
+    global_state.audio_settings.samplingRate = mix_rate;
+    global_state.audio_settings.frameSize = global_state.buffer_size;
+    global_state.hrtf_settings.type = IPL_HRTFTYPE_DEFAULT;
+
+    global_state.raytracer = RAYTRACER_EMBREE_STEAMAUDIO;
+    global_state.scene_settings.type = IPL_SCENETYPE_EMBREE;
+    global_state.use_radeon_rays = false;
+
+    global_state.sim_settings.flags = static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT | IPL_SIMULATIONFLAGS_REFLECTIONS);
+    global_state.sim_settings.maxNumOcclusionSamples = MAX_OCCLUSION_NUM_SAMPLES;
+    global_state.sim_settings.frameSize = global_state.buffer_size;
+    global_state.sim_settings.samplingRate = mix_rate;
+    global_state.sim_settings.reflectionType = IPL_REFLECTIONEFFECTTYPE_CONVOLUTION;
+    global_state.sim_settings.numThreads = 1;
+    apply_quality_settings_steamaudio(global_state, quality_preset_steamaudio(QUALITY_TIER_HIGH_STEAMAUDIO));
+}
+
+//High is what the module always used, the other tiers scale rays, IR length and source count around it
+QualitySettingsSteamAudio quality_preset_steamaudio(int tier) {
+    QualitySettingsSteamAudio quality;
+    switch (tier) {
+        case QUALITY_TIER_LOW_STEAMAUDIO:
+            quality.ambisonics_order = 1;
+            quality.max_num_rays = 1024;
+            quality.num_diffuse_samples = 16;
+            quality.max_duration = 1.0f;
+            quality.max_num_sources = 64;
+            quality.num_bounces = 4;
+            break;
+        case QUALITY_TIER_MEDIUM_STEAMAUDIO:
+            quality.ambisonics_order = 2;
+            quality.max_num_rays = 2048;
+            quality.num_diffuse_samples = 32;
+            quality.max_duration = 1.5f;
+            quality.max_num_sources = 128;
+            quality.num_bounces = 8;
+            break;
+        case QUALITY_TIER_ULTRA_STEAMAUDIO:
+            quality.ambisonics_order = 3;
+            quality.max_num_rays = 8192;
+            quality.num_diffuse_samples = 64;
+            quality.max_duration = 2.0f;
+            quality.max_num_sources = 256;
+            quality.num_bounces = 32;
+            break;
+        default:
+            break;
+    }
+    return quality;
+}
+
+QualitySettingsSteamAudio get_quality_settings_steamaudio(const GlobalStateSteamAudio& global_state) {
+    QualitySettingsSteamAudio quality;
+    quality.ambisonics_order = global_state.sim_settings.maxOrder;
+    quality.max_num_rays = global_state.sim_settings.maxNumRays;
+    quality.num_diffuse_samples = global_state.sim_settings.numDiffuseSamples;
+    quality.max_duration = global_state.sim_settings.maxDuration;
+    quality.max_num_sources = global_state.sim_settings.maxNumSources;
+    quality.num_bounces = global_state.num_bounces;
+    return quality;
+}
+
+//Only takes effect for simulators and effects created afterwards
+void apply_quality_settings_steamaudio(GlobalStateSteamAudio& global_state, const QualitySettingsSteamAudio& quality) {
+    global_state.sim_settings.maxOrder = quality.ambisonics_order;
+    global_state.sim_settings.maxNumRays = quality.max_num_rays;
+    global_state.sim_settings.numDiffuseSamples = quality.num_diffuse_samples;
+    global_state.sim_settings.maxDuration = quality.max_duration;
+    global_state.sim_settings.maxNumSources = quality.max_num_sources;
+    global_state.num_bounces = quality.num_bounces;
+}
+
+//Per-source reflection inputs that don't change between passes
+void set_reflection_inputs_steamaudio(const GlobalStateSteamAudio& global_state, IPLSimulationInputs& inputs) {
+    inputs.reverbScale[0] = 1.0f;
+    inputs.reverbScale[1] = 1.0f;
+    inputs.reverbScale[2] = 1.0f;
+    inputs.hybridReverbTransitionTime = global_state.hybrid_transition_time;
+    inputs.hybridReverbOverlapPercent = global_state.hybrid_overlap;
+}
+
+//Material for geometry without a SteamAudioMaterial, kept here so the headless bench shares it
+IPLMaterial * default_ipl_material_steamaudio() {
+    static IPLMaterial default_material = {
+        {0.10f, 0.20f, 0.30f},
+        0.05f,
+        {0.100f, 0.050f, 0.030f}
+    };
+    return &default_material;
+}
+
+static int create_global_objects_steamaudio(GlobalStateSteamAudio& global_state);
+
+//Creates the context, HRTF, scene and simulator from the settings already in global_state,
+//on failure whatever was created so far is released again
+int create_global_state_steamaudio(GlobalStateSteamAudio& global_state) {
+    int error_code = create_global_objects_steamaudio(global_state);
+    if (error_code) {
+        deinit_global_state_steamaudio(global_state);
+        iplEmbreeDeviceRelease(&(global_state.embree_device));
+    }
+    return error_code;
+}
+
+static int create_global_objects_steamaudio(GlobalStateSteamAudio& global_state) {
     global_state.phonon_ctx = nullptr;
-    IPLerror error_code = iplContextCreate(&(global_state.phonon_ctx_settings), &(global_state.phonon_ctx));
+    IPLerror error_code = IPL_STATUS_SUCCESS;
+    {
+        MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_OTHER_STEAMAUDIO);
+        error_code = iplContextCreate(&(global_state.phonon_ctx_settings), &(global_state.phonon_ctx));
+    }
     if (error_code) {
         printf("Err code for iplContextCreate: %d\n",error_code);
         return (int)error_code;
     }
-    float mix_rate = GLOBAL_GET("audio/driver/mix_rate");
-    int latency = GLOBAL_GET("audio/driver/output_latency"); 
-    global_state.buffer_size = closest_power_of_2(latency * mix_rate / 1000);
-    printf("mix_rate %f latency %d buffer_size %u\n", mix_rate, latency, global_state.buffer_size);   
-
-    global_state.audio_settings.samplingRate = mix_rate;
-    global_state.audio_settings.frameSize = global_state.buffer_size;
-    global_state.sim_settings.maxOrder = MAX_AMBISONICS_ORDER_DEFAULT;
-
-    global_state.hrtf_settings.type = IPL_HRTFTYPE_DEFAULT;
 
-    error_code = iplHRTFCreate(global_state.phonon_ctx, &(global_state.audio_settings), &(global_state.hrtf_settings), &(global_state.hrtf));
+    {
+        MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_HRTF_STEAMAUDIO);
+        error_code = iplHRTFCreate(global_state.phonon_ctx, &(global_state.audio_settings), &(global_state.hrtf_settings), &(global_state.hrtf));
+    }
     if (error_code) {
         printf("Err code for iplHRTFCreate: %d\n",error_code);
         return (int)error_code;
     }
 
-    global_state.scene_settings.type = IPL_SCENETYPE_DEFAULT;
-
     global_state.opencl_device = nullptr;
     global_state.tan_device = nullptr;
 
-   //This would be a good point to check Godot project settings for the type of raytracer to use for indirect sims
    // global_state.use_radeon_rays = ??
-   // also, opencl may not be supported on all platforms, so fallback should be to use embree
+   // opencl may not be supported on all platforms, so fallback should be to use embree
    // this may especially be the case on Linux platforms
 
-    //Get these from project settings
-
-    IPLSceneType scene_type = IPL_SCENETYPE_EMBREE;
+    IPLSceneType scene_type = global_state.scene_settings.type;
     if (global_state.use_radeon_rays) {
 
         IPLOpenCLDeviceSettings ocl_device_settings{};
@@ -170,7 +347,8 @@ int init_global_state_steamaudio(GlobalStateSteamAudio& global_state) {
         }
     }
 
-    if (!global_state.use_radeon_rays) {
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SCENE_STEAMAUDIO);
+    if (scene_type == IPL_SCENETYPE_EMBREE) {
         //create Embree device
         IPLEmbreeDeviceSettings embree_device_settings{};
         error_code = iplEmbreeDeviceCreate(global_state.phonon_ctx, &(embree_device_settings), &(global_state.embree_device));
@@ -192,48 +370,48 @@ int init_global_state_steamaudio(GlobalStateSteamAudio& global_state) {
         return (int)error_code;
     }
 
-    global_state.sim_settings.flags = static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT | IPL_SIMULATIONFLAGS_REFLECTIONS);
     global_state.sim_settings.sceneType = global_state.scene_settings.type;
-    global_state.sim_settings.maxNumOcclusionSamples = MAX_OCCLUSION_NUM_SAMPLES;
-    global_state.sim_settings.frameSize = global_state.buffer_size;
-    global_state.sim_settings.samplingRate = mix_rate;
-
-    global_state.sim_settings.reflectionType = IPL_REFLECTIONEFFECTTYPE_CONVOLUTION;
-    global_state.sim_settings.maxNumSources = 256;
-    global_state.sim_settings.numThreads = 2;
-    global_state.sim_settings.numDiffuseSamples = 32;
-    global_state.sim_settings.maxNumRays =  4096;
-    global_state.sim_settings.maxDuration = 2.0f;
-    global_state.sim_settings.rayBatchSize = 1;
+    global_state.sim_settings.rayBatchSize = (scene_type == IPL_SCENETYPE_CUSTOM) ? 64 : 1;
     global_state.sim_settings.radeonRaysDevice = global_state.radeon_rays_device;
     global_state.sim_settings.openCLDevice = global_state.opencl_device;
     global_state.sim_settings.tanDevice = global_state.tan_device;
 
     global_state.simulator = nullptr;
-    error_code = iplSimulatorCreate(global_state.phonon_ctx, &(global_state.sim_settings), &(global_state.simulator));
+    {
+        MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO);
+        error_code = iplSimulatorCreate(global_state.phonon_ctx, &(global_state.sim_settings), &(global_state.simulator));
+    }
     if (error_code) {
         printf("Err code for iplSimulatorCreate: %d\n", error_code);
         return (int)error_code;
     }
 
     iplSimulatorSetScene(global_state.simulator, global_state.scene);
- 
 
     return 0;
 }
 
+static int alloc_local_state_steamaudio(GlobalStateSteamAudio& global_state, LocalStateSteamAudio& local_state);
+
+//On failure the buffers allocated so far are freed again, so callers only deinit states that initialized
 int init_local_state_steamaudio(GlobalStateSteamAudio& global_state, LocalStateSteamAudio& local_state) {
-    local_state.spatial_blend = 1.0f;
-    local_state.sim_outputs.direct_valid[0].store(false);
-    local_state.sim_outputs.direct_valid[1].store(false);
+    int error_code = alloc_local_state_steamaudio(global_state, local_state);
+    if (error_code) {
+        deinit_local_state_steamaudio(global_state, local_state);
+    }
+    return error_code;
+}
 
-    local_state.sim_outputs.indirect_valid[0].store(false);
-    local_state.sim_outputs.indirect_valid[1].store(false);
+static int alloc_local_state_steamaudio(GlobalStateSteamAudio& global_state, LocalStateSteamAudio& local_state) {
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SOURCE_BUFFERS_STEAMAUDIO);
+    local_state.spatial_blend = 1.0f;
+    local_state.reflection_type = global_state.sim_settings.reflectionType;
     local_state.work_buffer = (AudioFrame *)memalloc(sizeof(AudioFrame)*global_state.buffer_size);
     if (local_state.work_buffer == nullptr) {
         printf("Failed to alloc mem for work buffer\n");
         return -1;
     }
+    track_memory_steamaudio(MEMORY_CATEGORY_SOURCE_BUFFERS_STEAMAUDIO, sizeof(AudioFrame)*global_state.buffer_size);
     IPLerror error_code = iplAudioBufferAllocate(global_state.phonon_ctx, N_CHANNELS_INOUT, global_state.buffer_size, &(local_state.in_buffer));
     if (error_code) {
         printf("Err code for iplAudioBufferAllocate: %d\n", error_code);
@@ -258,29 +436,62 @@ int init_local_state_steamaudio(GlobalStateSteamAudio& global_state, LocalStateS
         printf("Error allocating %d channels %d frames for mono_buffer\n",N_CHANNELS_MONO,global_state.buffer_size);
         return (int)error_code;
     }
-    error_code = iplAudioBufferAllocate(global_state.phonon_ctx, num_channels_for_order(global_state.sim_settings.maxOrder), global_state.buffer_size, &(local_state.ambisonics_buffer));
+    int ambisonics_error_code = init_ambisonics_buffers_steamaudio(global_state, local_state.ambisonics_buffer, local_state.refl_buffer);
+    if (ambisonics_error_code) {
+        return ambisonics_error_code;
+    }
+    error_code = iplAudioBufferAllocate(global_state.phonon_ctx, N_CHANNELS_INOUT, global_state.buffer_size, &(local_state.spat_buffer));
     if (error_code) {
         printf("Err code for iplAudioBufferAllocate: %d\n", error_code);
-        printf("Error allocating %d channels %d frames for ambisonics_buffer\n",num_channels_for_order(global_state.sim_settings.maxOrder),global_state.buffer_size);
+        printf("Error allocating %d channels %d frames for spat_buffer\n",N_CHANNELS_INOUT,global_state.buffer_size);
         return (int)error_code;
     }
-    error_code = iplAudioBufferAllocate(global_state.phonon_ctx, num_channels_for_order(global_state.sim_settings.maxOrder), global_state.buffer_size, &(local_state.refl_buffer));
+
+    return 0;
+}
+
+//The buffers sized by the ambisonics order, split out so a quality change can rebuild just these
+int init_ambisonics_buffers_steamaudio(GlobalStateSteamAudio& global_state, IPLAudioBuffer& ambisonics_buffer, IPLAudioBuffer& refl_buffer) {
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SOURCE_BUFFERS_STEAMAUDIO);
+    int num_channels = num_channels_for_order(global_state.sim_settings.maxOrder);
+    IPLerror error_code = iplAudioBufferAllocate(global_state.phonon_ctx, num_channels, global_state.buffer_size, &ambisonics_buffer);
     if (error_code) {
         printf("Err code for iplAudioBufferAllocate: %d\n", error_code);
-        printf("Error allocating %d channels %d frames for refl_buffer\n",num_channels_for_order(global_state.sim_settings.maxOrder),global_state.buffer_size);
+        printf("Error allocating %d channels %d frames for ambisonics_buffer\n",num_channels,global_state.buffer_size);
         return (int)error_code;
     }
-    error_code = iplAudioBufferAllocate(global_state.phonon_ctx, N_CHANNELS_INOUT, global_state.buffer_size, &(local_state.spat_buffer));
+    error_code = iplAudioBufferAllocate(global_state.phonon_ctx, num_channels, global_state.buffer_size, &refl_buffer);
     if (error_code) {
         printf("Err code for iplAudioBufferAllocate: %d\n", error_code);
-        printf("Error allocating %d channels %d frames for spat_buffer\n",N_CHANNELS_INOUT,global_state.buffer_size);
+        printf("Error allocating %d channels %d frames for refl_buffer\n",num_channels,global_state.buffer_size);
         return (int)error_code;
     }
-
     return 0;
 }
 
-int init_effect_steamaudio(GlobalStateSteamAudio& global_state, EffectSteamAudio& effect) {
+//Builds the buffers and one effect per entry already in resources.effects
+int init_quality_resources_steamaudio(GlobalStateSteamAudio& global_state, QualityResourcesSteamAudio& resources) {
+    int error_code = init_ambisonics_buffers_steamaudio(global_state, resources.ambisonics_buffer, resources.refl_buffer);
+    for (uint32_t i = 0; i < resources.effects.size() && error_code == 0; i++) {
+        error_code = init_effect_steamaudio(global_state, resources.effects[i], resources.reflection_type);
+    }
+    return error_code;
+}
+
+static int create_effects_steamaudio(GlobalStateSteamAudio& global_state, EffectSteamAudio& effect, IPLReflectionEffectType reflection_type);
+
+//reflection_type has to be one the simulator produces outputs for, a hybrid simulator serves all three.
+//On failure the effects created so far are released again
+int init_effect_steamaudio(GlobalStateSteamAudio& global_state, EffectSteamAudio& effect, IPLReflectionEffectType reflection_type) {
+    int error_code = create_effects_steamaudio(global_state, effect, reflection_type);
+    if (error_code) {
+        deinit_effect_steamaudio(global_state, effect);
+    }
+    return error_code;
+}
+
+static int create_effects_steamaudio(GlobalStateSteamAudio& global_state, EffectSteamAudio& effect, IPLReflectionEffectType reflection_type) {
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_EFFECTS_STEAMAUDIO);
     effect.binaural_settings.hrtf = global_state.hrtf;
     IPLerror error_code = iplBinauralEffectCreate(global_state.phonon_ctx, &(global_state.audio_settings), &(effect.binaural_settings), &(effect.binaural_effect));
     if (error_code) {
@@ -303,7 +514,7 @@ int init_effect_steamaudio(GlobalStateSteamAudio& global_state, EffectSteamAudio
 
     effect.refl_settings.numChannels = num_channels_for_order(global_state.sim_settings.maxOrder);
     effect.refl_settings.irSize = num_samps_for_duration(global_state.sim_settings.maxDuration, global_state.audio_settings.samplingRate);
-    effect.refl_settings.type = global_state.sim_settings.reflectionType; 
+    effect.refl_settings.type = reflection_type;
     error_code = iplReflectionEffectCreate(global_state.phonon_ctx, &(global_state.audio_settings), &(effect.refl_settings), &(effect.refl_effect));
     if (error_code) {
         printf("Err code for iplReflectionEffectCreate: %d\n", error_code);
@@ -345,16 +556,21 @@ int deinit_global_state_steamaudio(GlobalStateSteamAudio& global_state) {
     return 0;
 }
 
+//Buffers are cleared after freeing, so deiniting a state twice or one that never allocated is harmless
 int deinit_local_state_steamaudio(GlobalStateSteamAudio& global_state, LocalStateSteamAudio& local_state) { 
-    iplAudioBufferFree(global_state.phonon_ctx, &(local_state.in_buffer));
-    iplAudioBufferFree(global_state.phonon_ctx, &(local_state.out_buffer));
-    iplAudioBufferFree(global_state.phonon_ctx, &(local_state.direct_buffer));
-    iplAudioBufferFree(global_state.phonon_ctx, &(local_state.mono_buffer));
-    iplAudioBufferFree(global_state.phonon_ctx, &(local_state.ambisonics_buffer));
-    iplAudioBufferFree(global_state.phonon_ctx, &(local_state.refl_buffer));
-    iplAudioBufferFree(global_state.phonon_ctx, &(local_state.spat_buffer));
-    if (local_state.work_buffer!=nullptr)
+    IPLAudioBuffer * buffers[7] = {&(local_state.in_buffer), &(local_state.out_buffer), &(local_state.direct_buffer), &(local_state.mono_buffer),
+        &(local_state.ambisonics_buffer), &(local_state.refl_buffer), &(local_state.spat_buffer)};
+    for (IPLAudioBuffer * buffer : buffers) {
+        if (buffer->data != nullptr) {
+            iplAudioBufferFree(global_state.phonon_ctx, buffer);
+        }
+        *buffer = IPLAudioBuffer{};
+    }
+    if (local_state.work_buffer!=nullptr) {
         memfree(local_state.work_buffer);
+        local_state.work_buffer = nullptr;
+        track_memory_steamaudio(MEMORY_CATEGORY_SOURCE_BUFFERS_STEAMAUDIO, -(int64_t)(sizeof(AudioFrame)*global_state.buffer_size));
+    }
     return 0;
 }
 
@@ -369,3 +585,13 @@ int deinit_effect_steamaudio(GlobalStateSteamAudio& global_state, EffectSteamAud
 
     return 0;
 }
+
+int deinit_quality_resources_steamaudio(GlobalStateSteamAudio& global_state, QualityResourcesSteamAudio& resources) {
+    iplAudioBufferFree(global_state.phonon_ctx, &(resources.ambisonics_buffer));
+    iplAudioBufferFree(global_state.phonon_ctx, &(resources.refl_buffer));
+    for (uint32_t i = 0; i < resources.effects.size(); i++) {
+        deinit_effect_steamaudio(global_state, resources.effects[i]);
+    }
+    resources.effects.clear();
+    return 0;
+}
@@ -26,15 +26,32 @@ SOFTWARE.
 #define GODOT_STEAMAUDIO_H
 
 #include "core/object/ref_counted.h"
+#include "core/templates/local_vector.h"
 #include "servers/audio/audio_stream.h"
 #include "scene/3d/node_3d.h"
 #include <phonon.h>
+#include "steamaudio_lockfree.h"
 
 #define MAX_OCCLUSION_NUM_SAMPLES 16
 #define MAX_AMBISONICS_ORDER_DEFAULT 2
+#define RAYTRACER_EMBREE_STEAMAUDIO 0
+#define RAYTRACER_PHYSICS_STEAMAUDIO 1
+#define RAYTRACER_DEFAULT_STEAMAUDIO 2
+#define QUALITY_TIER_LOW_STEAMAUDIO 0
+#define QUALITY_TIER_MEDIUM_STEAMAUDIO 1
+#define QUALITY_TIER_HIGH_STEAMAUDIO 2
+#define QUALITY_TIER_ULTRA_STEAMAUDIO 3
+#define QUALITY_TIER_CUSTOM_STEAMAUDIO 4
+#define SPATIALIZE_HISTOGRAM_BUCKETS_STEAMAUDIO 64
+//Seconds a reflection IR takes to glide across its whole length when a source's IR length changes
+#define IR_GLIDE_TIME_STEAMAUDIO 0.25f
+#define SPATIALIZE_HISTOGRAM_BUCKET_USEC_STEAMAUDIO 25
 class AudioStreamPlayerSteamAudio;
 class AudioStreamPlaybackSteamAudio;
 class AudioStreamSteamAudio;
+struct SourceClusterSteamAudio;
+struct PhysicsSnapshotSteamAudio;
+class SteamAudioReverbZone;
 
 inline int num_channels_for_order(int order) {
     return ((order+1)*(order+1));
@@ -50,10 +67,23 @@ inline Vector3 IPLVec3toGDVec3(IPLVector3 vec_in) {
 inline IPLVector3 GDVec3toIPLVec3(Vector3 vec_in) { 
     return IPLVector3{vec_in.x,vec_in.y,vec_in.z};
 }
+inline IPLMatrix4x4 GDTransformtoIPLMatrix4x4(const Transform3D& xform_in) {
+    //Row-major with the translation in the last column
+    IPLMatrix4x4 mat_out{};
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            mat_out.elements[row][col] = xform_in.basis.rows[row][col];
+        }
+        mat_out.elements[row][3] = xform_in.origin[row];
+    }
+    mat_out.elements[3][3] = 1.0f;
+    return mat_out;
+}
 
 struct SteamAudioSource {
     IPLSource src;
     AudioStreamPlayerSteamAudio * steamaudio_player;
+    AudioStreamPlaybackSteamAudio * playback = nullptr;
     bool source_initialized = false;
 };
 
@@ -75,7 +105,9 @@ struct EffectSteamAudio {
     IPLAmbisonicsDecodeEffect ambisonics_dec_effect = nullptr;
     IPLAmbisonicsEncodeEffect ambisonics_enc_effect = nullptr;
     IPLAmbisonicsDecodeEffect indirect_ambisonics_dec_effect = nullptr;
-    
+
+//Audio thread only, the IR length in samples the reflection effect last used, 0 before the first block
+    float ir_size = 0.0f;
 };
 
 struct DirectOutputsSteamAudio {
@@ -90,34 +122,39 @@ struct IndirectOutputsSteamAudio {
 };
 
 struct SimOutputsSteamAudio {
-    DirectOutputsSteamAudio direct_outputs[2];
-    IndirectOutputsSteamAudio indirect_outputs[2];
-   
-    std::atomic<int> direct_idx = 0;
-    std::atomic<int> indirect_idx = 0;
-    std::atomic<bool> direct_valid[2] = {false,false};
-    std::atomic<bool> indirect_valid[2] = {false,false};
-    std::atomic<bool> direct_read_done = false;
-    std::atomic<bool> indirect_read_done = false;
-    
+    TripleBufferSteamAudio<DirectOutputsSteamAudio> direct;
+    TripleBufferSteamAudio<IndirectOutputsSteamAudio> indirect;
+
+    bool direct_sim_started = false;
     bool indirect_sim_started = false;
 };
- 
-inline int get_read_direct_idx(SimOutputsSteamAudio * sim_outputs) {
-    return (1-sim_outputs->direct_idx.load());
-}
 
-inline int get_read_indirect_idx(SimOutputsSteamAudio * sim_outputs) {
-    return (1-sim_outputs->indirect_idx.load());
-}
-
-inline int get_write_direct_idx(SimOutputsSteamAudio * sim_outputs) {
-    return (sim_outputs->direct_idx.load());
-}
+//Simulation budget, everything here is fixed when the simulator and effects are created
+struct QualitySettingsSteamAudio {
+    int ambisonics_order = MAX_AMBISONICS_ORDER_DEFAULT;
+    int max_num_rays = 4096;
+    int num_diffuse_samples = 32;
+    float max_duration = 2.0f;
+    int max_num_sources = 256;
+    int num_bounces = 16;
+};
 
-inline int get_write_indirect_idx(SimOutputsSteamAudio * sim_outputs) {
-    return (sim_outputs->indirect_idx.load());
-}
+//Written from the simulation and audio threads, sampled by the Performance monitors on the main thread
+struct StatsSteamAudio {
+    std::atomic<uint64_t> tick_usec = 0;
+    std::atomic<uint64_t> direct_usec = 0;
+    std::atomic<uint64_t> reflections_usec = 0;
+    std::atomic<uint64_t> reflection_runs = 0;
+// Per-block spatialize time, drained each monitor window
+    std::atomic<uint32_t> spatialize_histogram[SPATIALIZE_HISTOGRAM_BUCKETS_STEAMAUDIO] = {};
+    std::atomic<uint64_t> spatialize_sum_usec = 0;
+    std::atomic<uint64_t> spatialize_min_usec = UINT64_MAX;
+// Module time per audio block summed over all players, mix_max_usec drained each monitor window
+    std::atomic<uint64_t> mix_overruns = 0;
+    std::atomic<uint64_t> mix_max_usec = 0;
+// Advanced once per block by the AudioServer mix callback and by render_offline()
+    std::atomic<uint64_t> mix_blocks = 0;
+};
 
 //Should be in SteamAudioServer
 struct GlobalStateSteamAudio {
@@ -139,13 +176,50 @@ struct GlobalStateSteamAudio {
     IPLTrueAudioNextDevice tan_device = nullptr;
 
     bool use_radeon_rays = false;
+// Custom ray-tracing against a snapshot of the physics world, swapped in from tick()
+    int raytracer = RAYTRACER_EMBREE_STEAMAUDIO;
+    PhysicsSnapshotSteamAudio * physics_snapshot = nullptr;
+    uint64_t physics_snapshot_interval_usec = 100000;
 
     unsigned int buffer_size;    
+    int num_bounces = 16;
+//Hybrid reflections convolve the IR up to the transition time and continue with a parametric tail.
+//The overlap is the fraction of the transition time the two are crossfaded over
+    float hybrid_transition_time = 1.0f;
+    float hybrid_overlap = 0.25f;
+
+// Static mesh cache, meshes are baked in world space so the key has to include the transform.
+// Moved or procedural geometry keeps adding entries, least recently used ones are evicted past the size cap
+    bool use_mesh_cache = false;
+    String mesh_cache_path;
+    uint64_t mesh_cache_max_size = 0;
+
+// Acoustic mesh simplification
+    bool simplify_geometry = false;
+    float simplify_tolerance = 0.1f;
+    float simplify_min_feature_size = 0.25f;
+    std::atomic<uint64_t> geometry_triangles_in = 0;
+    std::atomic<uint64_t> geometry_triangles_out = 0;
+
+// Set while render_offline() drives the playbacks itself, the driver's mixes get silence until it is done
+    std::atomic<bool> offline_render = false;
+
+// Pose history written by tick(), extrapolated by the audio thread to each block's output time
+    PoseRingBufferSteamAudio<16> listener_poses;
+//Toggled by render_offline() while the audio thread reads it
+    std::atomic<bool> pose_extrapolation = true;
+    uint64_t max_extrapolation_usec = 0;
+    uint64_t output_latency_usec = 0;
+
+// Static meshes currently in scene, kept so the scene can be captured
+    LocalVector<IPLStaticMesh> scene_static_meshes;
+
+    StatsSteamAudio stats;
 };
 
 struct LocalStateSteamAudio {
     float spatial_blend;
-    AudioFrame * work_buffer;    
+    AudioFrame * work_buffer = nullptr;    
 // Process controls
     bool apply_distance_atten = false;
     bool apply_air_absorption = false;
@@ -158,22 +232,46 @@ struct LocalStateSteamAudio {
 // Settings
     float setting_occlusion_radius = 1.0f;
     int setting_occlusion_num_samples = 16;
+//Reflection IR length in seconds from the player or its reverb zone, 0 leaves it to the simulation
+    std::atomic<float> setting_ir_duration = 0.0f;
+//Must match the type the source's reflection effects were created with
+    IPLReflectionEffectType reflection_type = IPL_REFLECTIONEFFECTTYPE_CONVOLUTION;
 
 // Sim state
     SimOutputsSteamAudio sim_outputs;
     float distance_attenuation_cache;
     Vector3 ambisonics_direction_cache;
     IPLCoordinateSpace3 source_coordinates_cache;
+    Vector3 published_source_pos;
+//Main thread only, the zone setting_ir_duration last came from
+    SteamAudioReverbZone * reverb_zone = nullptr;
+    PoseRingBufferSteamAudio<8> source_poses;
+    SourceClusterSteamAudio * cluster = nullptr;
+    uint32_t source_index_handle = UINT32_MAX;
+    std::atomic<uint64_t> last_spatialize_usec = 0;
     SteamAudioSource source;
 
 // Buffers
-    IPLAudioBuffer in_buffer;
-    IPLAudioBuffer out_buffer;
-    IPLAudioBuffer direct_buffer;
-    IPLAudioBuffer mono_buffer;
-    IPLAudioBuffer ambisonics_buffer;
-    IPLAudioBuffer refl_buffer;
-    IPLAudioBuffer spat_buffer;
+    IPLAudioBuffer in_buffer{};
+    IPLAudioBuffer out_buffer{};
+    IPLAudioBuffer direct_buffer{};
+    IPLAudioBuffer mono_buffer{};
+    IPLAudioBuffer ambisonics_buffer{};
+    IPLAudioBuffer refl_buffer{};
+    IPLAudioBuffer spat_buffer{};
+};
+
+QualitySettingsSteamAudio quality_preset_steamaudio(int tier);
+QualitySettingsSteamAudio get_quality_settings_steamaudio(const GlobalStateSteamAudio& global_state);
+void apply_quality_settings_steamaudio(GlobalStateSteamAudio& global_state, const QualitySettingsSteamAudio& quality);
+void set_reflection_inputs_steamaudio(const GlobalStateSteamAudio& global_state, IPLSimulationInputs& inputs);
+
+//The part of a playback sized by the quality settings, built ahead of a quality change and holding the old one after it
+struct QualityResourcesSteamAudio {
+    IPLReflectionEffectType reflection_type = IPL_REFLECTIONEFFECTTYPE_CONVOLUTION;
+    IPLAudioBuffer ambisonics_buffer{};
+    IPLAudioBuffer refl_buffer{};
+    LocalVector<EffectSteamAudio> effects;
 };
 
 int spatialize_steamaudio(GlobalStateSteamAudio& global_state,
@@ -183,11 +281,21 @@ int spatialize_steamaudio(GlobalStateSteamAudio& global_state,
 inline Vector3 IPLVec3toGDVec3(IPLVector3 vec_in);
 inline IPLVector3 GDVec3toIPLVec3(Vector3 vec_in);
 
+void record_spatialize_time_steamaudio(StatsSteamAudio& stats, uint64_t usec);
+void record_mix_time_steamaudio(StatsSteamAudio& stats, uint64_t mix_step, uint64_t usec, uint64_t deadline_usec);
+
+IPLMaterial * default_ipl_material_steamaudio();
+void default_global_settings_steamaudio(GlobalStateSteamAudio& global_state, float mix_rate, unsigned int buffer_size);
+int create_global_state_steamaudio(GlobalStateSteamAudio& global_state);
+int load_global_settings_steamaudio(GlobalStateSteamAudio& global_state);
 int init_global_state_steamaudio(GlobalStateSteamAudio& global_state);
 int init_local_state_steamaudio(GlobalStateSteamAudio& global_state, LocalStateSteamAudio& local_state);
-int init_effect_steamaudio(GlobalStateSteamAudio& global_state, EffectSteamAudio& effect);
+int init_effect_steamaudio(GlobalStateSteamAudio& global_state, EffectSteamAudio& effect, IPLReflectionEffectType reflection_type);
+int init_ambisonics_buffers_steamaudio(GlobalStateSteamAudio& global_state, IPLAudioBuffer& ambisonics_buffer, IPLAudioBuffer& refl_buffer);
+int init_quality_resources_steamaudio(GlobalStateSteamAudio& global_state, QualityResourcesSteamAudio& resources);
 
 int deinit_global_state_steamaudio(GlobalStateSteamAudio& global_state);
 int deinit_local_state_steamaudio(GlobalStateSteamAudio& global_state, LocalStateSteamAudio& local_state);
 int deinit_effect_steamaudio(GlobalStateSteamAudio& global_state, EffectSteamAudio& effect);
+int deinit_quality_resources_steamaudio(GlobalStateSteamAudio& global_state, QualityResourcesSteamAudio& resources);
 #endif // GODOT_STEAMAUDIO_H
@@ -31,6 +31,11 @@ SOFTWARE.
 #include "steamaudio_listener.h"
 #include "steamaudio_server.h"
 #include "steamaudio_geometry.h"
+#include "steamaudio_instanced_geometry.h"
+#include "steamaudio_chunked_geometry.h"
+#include "steamaudio_material.h"
+#include "steamaudio_settings.h"
+#include "steamaudio_reverb_zone.h"
 
 static SteamAudioServer *steamaudio_server = nullptr;
 
@@ -45,6 +50,11 @@ void initialize_godot_steamaudio_module(ModuleInitializationLevel p_level) {
         ClassDB::register_class<AudioStreamPlayerSteamAudio>();
         ClassDB::register_class<SteamAudioListener>();
         ClassDB::register_class<SteamAudioGeometry>();
+        ClassDB::register_class<SteamAudioInstancedGeometry>();
+        ClassDB::register_class<SteamAudioChunkedGeometry>();
+        ClassDB::register_class<SteamAudioMaterial>();
+        ClassDB::register_class<SteamAudioSettings>();
+        ClassDB::register_class<SteamAudioReverbZone>();
     }
 
     if (p_level==MODULE_INITIALIZATION_LEVEL_SERVERS) {
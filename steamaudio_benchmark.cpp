@@ -0,0 +1,218 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_benchmark.h"
+#include "steamaudio_material.h"
+#include "core/math/math_funcs.h"
+
+#define BENCHMARK_ROOM_SIZE_STEAMAUDIO 20.0f
+#define BENCHMARK_NUM_SOURCES_STEAMAUDIO 8
+
+static void append_quad_grid_steamaudio(const Vector3& origin, const Vector3& edge_u, const Vector3& edge_v, int subdivisions, MeshDataSteamAudio& mesh_data) {
+    int base = mesh_data.verts.size();
+    for (int vrow = 0; vrow <= subdivisions; vrow++) {
+        for (int ucol = 0; ucol <= subdivisions; ucol++) {
+            Vector3 pos = origin + edge_u * ((float)ucol / subdivisions) + edge_v * ((float)vrow / subdivisions);
+            mesh_data.verts.push_back(GDVec3toIPLVec3(pos));
+        }
+    }
+    int stride = subdivisions + 1;
+    for (int vrow = 0; vrow < subdivisions; vrow++) {
+        for (int ucol = 0; ucol < subdivisions; ucol++) {
+            int corner = base + vrow * stride + ucol;
+            mesh_data.triangles.push_back(IPLTriangle{{corner, corner + 1, corner + stride + 1}});
+            mesh_data.triangles.push_back(IPLTriangle{{corner, corner + stride + 1, corner + stride}});
+        }
+    }
+}
+
+//Closed box room with a row of pillars, each face split into subdivisions^2 quads
+void build_benchmark_mesh_steamaudio(int subdivisions, MeshDataSteamAudio& mesh_data) {
+    subdivisions = MAX(subdivisions, 1);
+    const float size = BENCHMARK_ROOM_SIZE_STEAMAUDIO;
+    const float height = size * 0.5f;
+    const Vector3 x_axis(size, 0.0f, 0.0f);
+    const Vector3 y_axis(0.0f, height, 0.0f);
+    const Vector3 z_axis(0.0f, 0.0f, size);
+    const Vector3 room_min(-size * 0.5f, 0.0f, -size * 0.5f);
+
+    append_quad_grid_steamaudio(room_min, z_axis, x_axis, subdivisions, mesh_data);
+    append_quad_grid_steamaudio(room_min + y_axis, x_axis, z_axis, subdivisions, mesh_data);
+    append_quad_grid_steamaudio(room_min, x_axis, y_axis, subdivisions, mesh_data);
+    append_quad_grid_steamaudio(room_min + z_axis, y_axis, x_axis, subdivisions, mesh_data);
+    append_quad_grid_steamaudio(room_min, y_axis, z_axis, subdivisions, mesh_data);
+    append_quad_grid_steamaudio(room_min + x_axis, z_axis, y_axis, subdivisions, mesh_data);
+
+    const float pillar_width = 1.0f;
+    for (int pidx = 1; pidx < 4; pidx++) {
+        Vector3 pillar_min(room_min.x + size * pidx / 4.0f, 0.0f, -pillar_width * 0.5f);
+        Vector3 pillar_x(pillar_width, 0.0f, 0.0f);
+        Vector3 pillar_z(0.0f, 0.0f, pillar_width);
+        append_quad_grid_steamaudio(pillar_min, y_axis, pillar_x, subdivisions, mesh_data);
+        append_quad_grid_steamaudio(pillar_min + pillar_z, pillar_x, y_axis, subdivisions, mesh_data);
+        append_quad_grid_steamaudio(pillar_min, pillar_z, y_axis, subdivisions, mesh_data);
+        append_quad_grid_steamaudio(pillar_min + pillar_x, y_axis, pillar_z, subdivisions, mesh_data);
+    }
+
+    mesh_data.material_indices.resize(mesh_data.triangles.size());
+    memset(mesh_data.material_indices.ptrw(), 0, sizeof(IPLint32)*mesh_data.triangles.size());
+}
+
+//Builds the benchmark room for one backend on its own scene and simulator, then
+//times reflection simulation with the configured ray counts
+int benchmark_raytracer_steamaudio(GlobalStateSteamAudio& global_state, IPLSceneType scene_type, int subdivisions, int iterations, Dictionary& result) {
+    MeshDataSteamAudio mesh_data;
+    build_benchmark_mesh_steamaudio(subdivisions, mesh_data);
+    IPLEmbreeDevice embree_device = nullptr;
+    IPLScene scene = nullptr;
+    IPLStaticMesh static_mesh = nullptr;
+    IPLSimulator simulator = nullptr;
+    IPLSource sources[BENCHMARK_NUM_SOURCES_STEAMAUDIO] = {};
+    IPLerror error_code = IPL_STATUS_SUCCESS;
+
+    uint64_t build_start = ticks_usec_steamaudio();
+    IPLSceneSettings scene_settings{};
+    scene_settings.type = scene_type;
+    if (scene_type == IPL_SCENETYPE_EMBREE) {
+        IPLEmbreeDeviceSettings embree_device_settings{};
+        error_code = iplEmbreeDeviceCreate(global_state.phonon_ctx, &embree_device_settings, &embree_device);
+        if (error_code) {
+            printf("Err code for iplEmbreeDeviceCreate: %d\n", error_code);
+            return (int)error_code;
+        }
+        scene_settings.embreeDevice = embree_device;
+    }
+    error_code = iplSceneCreate(global_state.phonon_ctx, &scene_settings, &scene);
+    if (error_code) {
+        printf("Err code for iplSceneCreate: %d\n", error_code);
+        iplEmbreeDeviceRelease(&embree_device);
+        return (int)error_code;
+    }
+
+    IPLStaticMeshSettings static_mesh_settings{};
+    static_mesh_settings.numVertices = mesh_data.verts.size();
+    static_mesh_settings.numTriangles = mesh_data.triangles.size();
+    static_mesh_settings.numMaterials = 1;
+    static_mesh_settings.vertices = mesh_data.verts.ptrw();
+    static_mesh_settings.triangles = mesh_data.triangles.ptrw();
+    static_mesh_settings.materialIndices = mesh_data.material_indices.ptrw();
+    static_mesh_settings.materials = SteamAudioMaterial::get_default_ipl_material();
+    error_code = iplStaticMeshCreate(scene, &static_mesh_settings, &static_mesh);
+    if (error_code) {
+        printf("Err code for iplStaticMeshCreate: %d\n", error_code);
+        iplSceneRelease(&scene);
+        iplEmbreeDeviceRelease(&embree_device);
+        return (int)error_code;
+    }
+    iplStaticMeshAdd(static_mesh, scene);
+    iplSceneCommit(scene);
+    uint64_t build_usec = ticks_usec_steamaudio() - build_start;
+
+    IPLSimulationSettings sim_settings = global_state.sim_settings;
+    sim_settings.flags = IPL_SIMULATIONFLAGS_REFLECTIONS;
+    sim_settings.sceneType = scene_type;
+    sim_settings.rayBatchSize = 1;
+    error_code = iplSimulatorCreate(global_state.phonon_ctx, &sim_settings, &simulator);
+    if (error_code) {
+        printf("Err code for iplSimulatorCreate: %d\n", error_code);
+        iplStaticMeshRelease(&static_mesh);
+        iplSceneRelease(&scene);
+        iplEmbreeDeviceRelease(&embree_device);
+        return (int)error_code;
+    }
+    iplSimulatorSetScene(simulator, scene);
+
+    IPLSourceSettings source_settings{};
+    source_settings.flags = IPL_SIMULATIONFLAGS_REFLECTIONS;
+    for (int sidx = 0; sidx < BENCHMARK_NUM_SOURCES_STEAMAUDIO; sidx++) {
+        error_code = iplSourceCreate(simulator, &source_settings, &sources[sidx]);
+        if (error_code) {
+            printf("Err code for iplSourceCreate: %d\n", error_code);
+            for (int ridx = 0; ridx < sidx; ridx++) {
+                iplSourceRemove(sources[ridx], simulator);
+                iplSourceRelease(&sources[ridx]);
+            }
+            iplSimulatorRelease(&simulator);
+            iplStaticMeshRemove(static_mesh, scene);
+            iplStaticMeshRelease(&static_mesh);
+            iplSceneRelease(&scene);
+            iplEmbreeDeviceRelease(&embree_device);
+            return (int)error_code;
+        }
+        float angle = Math_TAU * sidx / BENCHMARK_NUM_SOURCES_STEAMAUDIO;
+        IPLSimulationInputs inputs{};
+        inputs.flags = IPL_SIMULATIONFLAGS_REFLECTIONS;
+        inputs.source.ahead = IPLVector3{0.0f, 0.0f, -1.0f};
+        inputs.source.up = IPLVector3{0.0f, 1.0f, 0.0f};
+        inputs.source.right = IPLVector3{1.0f, 0.0f, 0.0f};
+        inputs.source.origin = IPLVector3{6.0f * cosf(angle), 1.5f, 6.0f * sinf(angle)};
+        iplSourceSetInputs(sources[sidx], IPL_SIMULATIONFLAGS_REFLECTIONS, &inputs);
+        iplSourceAdd(sources[sidx], simulator);
+    }
+    iplSimulatorCommit(simulator);
+
+    const int num_bounces = 16;
+    IPLSimulationSharedInputs shared_inputs{};
+    shared_inputs.listener.ahead = IPLVector3{0.0f, 0.0f, -1.0f};
+    shared_inputs.listener.up = IPLVector3{0.0f, 1.0f, 0.0f};
+    shared_inputs.listener.right = IPLVector3{1.0f, 0.0f, 0.0f};
+    shared_inputs.listener.origin = IPLVector3{0.0f, 1.7f, 3.0f};
+    shared_inputs.numRays = sim_settings.maxNumRays;
+    shared_inputs.numBounces = num_bounces;
+    shared_inputs.duration = sim_settings.maxDuration;
+    shared_inputs.order = sim_settings.maxOrder;
+    shared_inputs.irradianceMinDistance = 1.0f;
+    iplSimulatorSetSharedInputs(simulator, IPL_SIMULATIONFLAGS_REFLECTIONS, &shared_inputs);
+
+    //Warm-up run so lazy allocations don't count against the first iteration
+    iplSimulatorRunReflections(simulator);
+    iterations = MAX(iterations, 1);
+    uint64_t trace_start = ticks_usec_steamaudio();
+    for (int iter = 0; iter < iterations; iter++) {
+        iplSimulatorRunReflections(simulator);
+    }
+    uint64_t trace_usec = MAX(ticks_usec_steamaudio() - trace_start, (uint64_t)1);
+
+    //Ray count is an upper bound, rays that escape early end before num_bounces
+    double num_rays = (double)shared_inputs.numRays * num_bounces * BENCHMARK_NUM_SOURCES_STEAMAUDIO * iterations;
+    result["triangles"] = (int)mesh_data.triangles.size();
+    result["scene_build_msec"] = build_usec / 1000.0;
+    result["reflections_msec"] = trace_usec / 1000.0 / iterations;
+    result["rays_per_second"] = num_rays * 1000000.0 / trace_usec;
+
+    for (int sidx = 0; sidx < BENCHMARK_NUM_SOURCES_STEAMAUDIO; sidx++) {
+        if (sources[sidx] != nullptr) {
+            iplSourceRemove(sources[sidx], simulator);
+            iplSourceRelease(&sources[sidx]);
+        }
+    }
+    iplSimulatorRelease(&simulator);
+    iplStaticMeshRemove(static_mesh, scene);
+    iplStaticMeshRelease(&static_mesh);
+    iplSceneRelease(&scene);
+    if (embree_device != nullptr) {
+        iplEmbreeDeviceRelease(&embree_device);
+    }
+    return 0;
+}
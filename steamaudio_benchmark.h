@@ -0,0 +1,34 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_BENCHMARK_H
+#define STEAMAUDIO_BENCHMARK_H
+
+#include "godot_steamaudio.h"
+#include "steamaudio_geometry.h"
+
+void build_benchmark_mesh_steamaudio(int subdivisions, MeshDataSteamAudio& mesh_data);
+int benchmark_raytracer_steamaudio(GlobalStateSteamAudio& global_state, IPLSceneType scene_type, int subdivisions, int iterations, Dictionary& result);
+
+#endif // STEAMAUDIO_BENCHMARK_H
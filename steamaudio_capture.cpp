@@ -0,0 +1,492 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_capture.h"
+#include "steamaudio_memory.h"
+#include "scene/resources/audio_stream_wav.h"
+#include <stdio.h>
+
+static void store_pose_steamaudio(Ref<FileAccess>& file, const IPLCoordinateSpace3& pose) {
+    const IPLVector3 * axes[4] = {&pose.right, &pose.up, &pose.ahead, &pose.origin};
+    for (const IPLVector3 * axis : axes) {
+        file->store_float(axis->x);
+        file->store_float(axis->y);
+        file->store_float(axis->z);
+    }
+}
+
+static IPLCoordinateSpace3 get_pose_steamaudio(Ref<FileAccess>& file) {
+    IPLCoordinateSpace3 pose{};
+    IPLVector3 * axes[4] = {&pose.right, &pose.up, &pose.ahead, &pose.origin};
+    for (IPLVector3 * axis : axes) {
+        axis->x = file->get_float();
+        axis->y = file->get_float();
+        axis->z = file->get_float();
+    }
+    return pose;
+}
+
+//Writes the header and a snapshot of the static meshes in the global scene, geometry changed later isn't captured
+Error begin_capture_steamaudio(GlobalStateSteamAudio& global_state, const CaptureSettingsSteamAudio& settings, const String& path, Ref<FileAccess>& file) {
+    Error err = OK;
+    file = FileAccess::open(path, FileAccess::WRITE, &err);
+    if (err != OK) {
+        printf("Err code for capture file open: %d\n", err);
+        return err;
+    }
+    file->store_32(CAPTURE_MAGIC_STEAMAUDIO);
+    file->store_32(CAPTURE_VERSION_STEAMAUDIO);
+    file->store_32(global_state.audio_settings.samplingRate);
+    file->store_32(global_state.buffer_size);
+    file->store_32(global_state.raytracer);
+    file->store_32(global_state.sim_settings.maxOrder);
+    file->store_32(global_state.sim_settings.maxNumRays);
+    file->store_32(global_state.sim_settings.numDiffuseSamples);
+    file->store_32(global_state.sim_settings.maxNumSources);
+    file->store_32(global_state.sim_settings.numThreads);
+    file->store_float(global_state.sim_settings.maxDuration);
+    file->store_32(global_state.sim_settings.reflectionType);
+    file->store_32(global_state.num_bounces);
+    file->store_float(global_state.hybrid_transition_time);
+    file->store_float(global_state.hybrid_overlap);
+    file->store_float(settings.direct_rate);
+    file->store_float(settings.reflection_rate);
+
+    file->store_32(global_state.scene_static_meshes.size());
+    for (IPLStaticMesh static_mesh : global_state.scene_static_meshes) {
+        IPLSerializedObjectSettings serialized_settings{};
+        IPLSerializedObject serialized_object = nullptr;
+        IPLerror error_code = iplSerializedObjectCreate(global_state.phonon_ctx, &serialized_settings, &serialized_object);
+        if (error_code) {
+            printf("Err code for iplSerializedObjectCreate: %d\n", error_code);
+            file->store_64(0);
+            continue;
+        }
+        iplStaticMeshSave(static_mesh, serialized_object);
+        file->store_64(iplSerializedObjectGetSize(serialized_object));
+        file->store_buffer(iplSerializedObjectGetData(serialized_object), iplSerializedObjectGetSize(serialized_object));
+        iplSerializedObjectRelease(&serialized_object);
+    }
+    return OK;
+}
+
+void capture_tick_steamaudio(Ref<FileAccess>& file, uint64_t time_usec, const IPLCoordinateSpace3& listener, const LocalVector<CaptureSourceSteamAudio>& sources) {
+    file->store_8(CAPTURE_TAG_TICK_STEAMAUDIO);
+    file->store_64(time_usec);
+    store_pose_steamaudio(file, listener);
+    file->store_32(sources.size());
+    for (const CaptureSourceSteamAudio& source : sources) {
+        file->store_64(source.id);
+        file->store_float(source.position.x);
+        file->store_float(source.position.y);
+        file->store_float(source.position.z);
+        file->store_float(source.occlusion_radius);
+        file->store_32(source.occlusion_num_samples);
+        file->store_32(source.reflection_type);
+    }
+}
+
+void end_capture_steamaudio(Ref<FileAccess>& file) {
+    file->store_8(CAPTURE_TAG_END_STEAMAUDIO);
+    file.unref();
+}
+
+struct ReplaySourceSteamAudio {
+    uint64_t id = 0;
+    IPLSource src = nullptr;
+    LocalStateSteamAudio local_state;
+    EffectSteamAudio effect;
+    uint32_t noise = 1;
+    bool seen = false;
+};
+
+static void release_replay_source_steamaudio(GlobalStateSteamAudio& global_state, ReplaySourceSteamAudio * source) {
+    if (source->src) {
+        iplSourceRemove(source->src, global_state.simulator);
+        iplSourceRelease(&(source->src));
+    }
+    deinit_effect_steamaudio(global_state, source->effect);
+    deinit_local_state_steamaudio(global_state, source->local_state);
+    memdelete(source);
+}
+
+static ReplaySourceSteamAudio * create_replay_source_steamaudio(GlobalStateSteamAudio& global_state, uint64_t id, IPLReflectionEffectType reflection_type) {
+    ReplaySourceSteamAudio * source = memnew(ReplaySourceSteamAudio);
+    source->id = id;
+    source->noise = (uint32_t)(id * 2654435761u) | 1;
+    int error_code = init_local_state_steamaudio(global_state, source->local_state);
+    if (error_code == 0) {
+        source->local_state.reflection_type = reflection_type;
+        error_code = init_effect_steamaudio(global_state, source->effect, reflection_type);
+    }
+    if (error_code == 0) {
+        IPLSourceSettings source_settings{};
+        source_settings.flags = static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT | IPL_SIMULATIONFLAGS_REFLECTIONS);
+        error_code = iplSourceCreate(global_state.simulator, &source_settings, &(source->src));
+        if (error_code) {
+            printf("Err code for iplSourceCreate: %d\n", error_code);
+        }
+    }
+    if (error_code) {
+        release_replay_source_steamaudio(global_state, source);
+        return nullptr;
+    }
+    iplSourceAdd(source->src, global_state.simulator);
+    return source;
+}
+
+//Replays a capture on a private context, scene and simulator, so it neither needs nor disturbs the running game.
+//Each tick runs the same direct pass as SteamAudioServer, reflections run at the captured rate and are waited on,
+//then every source spatializes a synthetic signal for the blocks the tick covers
+int replay_capture_steamaudio(const String& path, const String& wav_path, Dictionary& result) {
+    MEMORY_LEDGER_STEAMAUDIO(get_private_memory_ledger_steamaudio());
+    Error err = OK;
+    Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ, &err);
+    if (err != OK) {
+        printf("Err code for capture file open: %d\n", err);
+        return (int)err;
+    }
+    if (file->get_32() != CAPTURE_MAGIC_STEAMAUDIO || file->get_32() != CAPTURE_VERSION_STEAMAUDIO) {
+        printf("Not a Steam Audio capture: %s\n", path.utf8().get_data());
+        return (int)ERR_FILE_UNRECOGNIZED;
+    }
+
+    GlobalStateSteamAudio global_state;
+    float mix_rate = file->get_32();
+    unsigned int buffer_size = file->get_32();
+    if (mix_rate <= 0.0f || buffer_size == 0 || buffer_size > CAPTURE_MAX_BUFFER_SIZE_STEAMAUDIO) {
+        printf("Corrupt capture header: mix rate %.0f, buffer size %u\n", mix_rate, buffer_size);
+        return (int)ERR_FILE_CORRUPT;
+    }
+    default_global_settings_steamaudio(global_state, mix_rate, buffer_size);
+    global_state.raytracer = file->get_32();
+    //The physics world isn't part of a capture, those sessions replay against the built-in tracer without geometry
+    global_state.scene_settings.type = (global_state.raytracer == RAYTRACER_EMBREE_STEAMAUDIO) ? IPL_SCENETYPE_EMBREE : IPL_SCENETYPE_DEFAULT;
+    global_state.sim_settings.maxOrder = file->get_32();
+    global_state.sim_settings.maxNumRays = file->get_32();
+    global_state.sim_settings.numDiffuseSamples = file->get_32();
+    global_state.sim_settings.maxNumSources = file->get_32();
+    global_state.sim_settings.numThreads = file->get_32();
+    global_state.sim_settings.maxDuration = file->get_float();
+    global_state.sim_settings.reflectionType = (IPLReflectionEffectType)file->get_32();
+    global_state.num_bounces = file->get_32();
+    global_state.hybrid_transition_time = file->get_float();
+    global_state.hybrid_overlap = file->get_float();
+    //Every captured tick gets a direct pass, without a scheduler reflections also ran on every tick
+    float direct_rate = file->get_float();
+    float reflection_rate = file->get_float();
+    uint64_t reflection_interval_usec = (direct_rate > 0.0f && reflection_rate > 0.0f) ? (uint64_t)(1000000.0f / reflection_rate) : 0;
+    global_state.pose_extrapolation.store(false);
+    int error_code = create_global_state_steamaudio(global_state);
+    if (error_code) {
+        return error_code;
+    }
+
+    LocalVector<IPLStaticMesh> static_meshes;
+    uint32_t num_meshes = file->get_32();
+    //Every mesh is at least its 64-bit size
+    if ((uint64_t)num_meshes * sizeof(uint64_t) > file->get_length() - file->get_position()) {
+        printf("Corrupt capture: %u meshes don't fit in the file\n", num_meshes);
+        error_code = (int)ERR_FILE_CORRUPT;
+        num_meshes = 0;
+    }
+    for (uint32_t midx = 0; midx < num_meshes; midx++) {
+        uint64_t size = file->get_64();
+        if (size == 0) {
+            continue;
+        }
+        if (size > CAPTURE_MAX_MESH_BYTES_STEAMAUDIO || size > file->get_length() - file->get_position()) {
+            printf("Corrupt capture: mesh %u claims %llu bytes\n", midx, (unsigned long long)size);
+            error_code = (int)ERR_FILE_CORRUPT;
+            break;
+        }
+        Vector<uint8_t> data;
+        data.resize(size);
+        file->get_buffer(data.ptrw(), size);
+        IPLSerializedObjectSettings serialized_settings{};
+        serialized_settings.data = data.ptrw();
+        serialized_settings.size = data.size();
+        IPLSerializedObject serialized_object = nullptr;
+        IPLerror ipl_error = iplSerializedObjectCreate(global_state.phonon_ctx, &serialized_settings, &serialized_object);
+        if (ipl_error) {
+            printf("Err code for iplSerializedObjectCreate: %d\n", ipl_error);
+            continue;
+        }
+        IPLStaticMesh static_mesh = nullptr;
+        ipl_error = iplStaticMeshLoad(global_state.scene, serialized_object, nullptr, nullptr, &static_mesh);
+        iplSerializedObjectRelease(&serialized_object);
+        if (ipl_error) {
+            printf("Err code for iplStaticMeshLoad: %d\n", ipl_error);
+            continue;
+        }
+        iplStaticMeshAdd(static_mesh, global_state.scene);
+        static_meshes.push_back(static_mesh);
+    }
+    iplSceneCommit(global_state.scene);
+    iplSimulatorSetScene(global_state.simulator, global_state.scene);
+    iplSimulatorCommit(global_state.simulator);
+
+    LocalVector<ReplaySourceSteamAudio*> sources;
+    LocalVector<AudioFrame> mixed;
+    mixed.resize(buffer_size);
+    LocalVector<int16_t> samples;
+    bool write_wav = !wav_path.is_empty();
+    uint64_t first_usec = 0;
+    uint64_t num_ticks = 0;
+    uint64_t num_blocks = 0;
+    uint64_t num_reflection_passes = 0;
+    uint64_t direct_usec = 0;
+    uint64_t reflections_usec = 0;
+    uint64_t next_reflection_usec = 0;
+    int max_sources = 0;
+    uint64_t wall_start_usec = ticks_usec_steamaudio();
+
+    while (error_code == 0 && !file->eof_reached() && file->get_8() == CAPTURE_TAG_TICK_STEAMAUDIO) {
+        uint64_t time_usec = file->get_64();
+        IPLCoordinateSpace3 listener = get_pose_steamaudio(file);
+        if (num_ticks == 0) {
+            first_usec = time_usec;
+        }
+
+        //Sources join and leave the simulator as they did in the session
+        bool simulator_dirty = false;
+        for (ReplaySourceSteamAudio * source : sources) {
+            source->seen = false;
+        }
+        uint32_t num_sources = file->get_32();
+        if (num_sources > CAPTURE_MAX_SOURCES_STEAMAUDIO || (uint64_t)num_sources * CAPTURE_SOURCE_BYTES_STEAMAUDIO > file->get_length() - file->get_position()) {
+            printf("Corrupt capture: tick %llu claims %u sources\n", (unsigned long long)num_ticks, num_sources);
+            error_code = (int)ERR_FILE_CORRUPT;
+            break;
+        }
+        for (uint32_t sidx = 0; sidx < num_sources; sidx++) {
+            uint64_t id = file->get_64();
+            Vector3 position;
+            position.x = file->get_float();
+            position.y = file->get_float();
+            position.z = file->get_float();
+            float occlusion_radius = file->get_float();
+            int occlusion_num_samples = file->get_32();
+            uint32_t stored_reflection_type = file->get_32();
+            IPLReflectionEffectType reflection_type = (IPLReflectionEffectType)stored_reflection_type;
+            //Only a hybrid simulator serves players another type than its own
+            if (stored_reflection_type > IPL_REFLECTIONEFFECTTYPE_HYBRID || (reflection_type != global_state.sim_settings.reflectionType && global_state.sim_settings.reflectionType != IPL_REFLECTIONEFFECTTYPE_HYBRID)) {
+                printf("Corrupt capture: source %llu has reflection type %u\n", (unsigned long long)id, stored_reflection_type);
+                error_code = (int)ERR_FILE_CORRUPT;
+                break;
+            }
+
+            ReplaySourceSteamAudio * source = nullptr;
+            for (ReplaySourceSteamAudio * existing : sources) {
+                if (existing->id == id) {
+                    source = existing;
+                    break;
+                }
+            }
+            //A player that was played again with another type got new effects in the session too
+            if (source != nullptr && source->local_state.reflection_type != reflection_type) {
+                EffectSteamAudio effect;
+                int effect_error_code = init_effect_steamaudio(global_state, effect, reflection_type);
+                if (effect_error_code) {
+                    printf("Err code for init_effect_steamaudio: %d\n", effect_error_code);
+                } else {
+                    deinit_effect_steamaudio(global_state, source->effect);
+                    source->effect = effect;
+                    source->local_state.reflection_type = reflection_type;
+                }
+            }
+            if (source == nullptr) {
+                source = create_replay_source_steamaudio(global_state, id, reflection_type);
+                if (source == nullptr) {
+                    continue;
+                }
+                sources.push_back(source);
+                simulator_dirty = true;
+            }
+            source->seen = true;
+            source->local_state.published_source_pos = position;
+            source->local_state.setting_occlusion_radius = occlusion_radius;
+            source->local_state.setting_occlusion_num_samples = occlusion_num_samples;
+        }
+        if (error_code) {
+            break;
+        }
+        for (uint32_t sidx = 0; sidx < sources.size();) {
+            if (sources[sidx]->seen) {
+                sidx++;
+                continue;
+            }
+            release_replay_source_steamaudio(global_state, sources[sidx]);
+            sources.remove_at_unordered(sidx);
+            simulator_dirty = true;
+        }
+        if (simulator_dirty) {
+            iplSimulatorCommit(global_state.simulator);
+        }
+        max_sources = MAX(max_sources, (int)sources.size());
+
+        Vector3 listener_pos = IPLVec3toGDVec3(listener.origin);
+        IPLDistanceAttenuationModel distance_attenuation_model{};
+        distance_attenuation_model.type = IPL_DISTANCEATTENUATIONTYPE_DEFAULT;
+        for (ReplaySourceSteamAudio * source : sources) {
+            LocalStateSteamAudio& local_state = source->local_state;
+            Vector3 source_pos = local_state.published_source_pos;
+            local_state.distance_attenuation_cache = iplDistanceAttenuationCalculate(global_state.phonon_ctx, GDVec3toIPLVec3(source_pos), listener.origin, &distance_attenuation_model);
+            local_state.ambisonics_direction_cache = source_pos - listener_pos;
+            local_state.source_coordinates_cache = IPLCoordinateSpace3{};
+            local_state.source_coordinates_cache.origin = GDVec3toIPLVec3(source_pos);
+
+            IPLSimulationInputs inputs{};
+            inputs.flags = IPL_SIMULATIONFLAGS_DIRECT;
+            inputs.directFlags = static_cast<IPLDirectSimulationFlags>(IPL_DIRECTSIMULATIONFLAGS_OCCLUSION | IPL_DIRECTSIMULATIONFLAGS_TRANSMISSION);
+            inputs.source = local_state.source_coordinates_cache;
+            inputs.occlusionType = IPL_OCCLUSIONTYPE_VOLUMETRIC;
+            inputs.occlusionRadius = local_state.setting_occlusion_radius;
+            inputs.numOcclusionSamples = local_state.setting_occlusion_num_samples;
+            iplSourceSetInputs(source->src, IPL_SIMULATIONFLAGS_DIRECT, &inputs);
+        }
+        IPLSimulationSharedInputs shared_inputs{};
+        shared_inputs.listener = listener;
+        iplSimulatorSetSharedInputs(global_state.simulator, IPL_SIMULATIONFLAGS_DIRECT, &shared_inputs);
+        uint64_t start_usec = ticks_usec_steamaudio();
+        iplSimulatorRunDirect(global_state.simulator);
+        direct_usec += ticks_usec_steamaudio() - start_usec;
+        for (ReplaySourceSteamAudio * source : sources) {
+            LocalStateSteamAudio& local_state = source->local_state;
+            DirectOutputsSteamAudio& direct_outputs = local_state.sim_outputs.direct.write_slot();
+            direct_outputs.distance_attenuation = local_state.distance_attenuation_cache;
+            direct_outputs.listener_orientation = listener;
+            direct_outputs.listener_orientation.origin = IPLVector3{0.0f,0.0f,0.0f};
+            direct_outputs.ambisonics_direction = GDVec3toIPLVec3(local_state.ambisonics_direction_cache.normalized());
+            iplSourceGetOutputs(source->src, IPL_SIMULATIONFLAGS_DIRECT, &(direct_outputs.direct_sim_outputs));
+            local_state.sim_outputs.direct.publish(time_usec);
+        }
+
+        if (time_usec >= next_reflection_usec) {
+            for (ReplaySourceSteamAudio * source : sources) {
+                IPLSimulationInputs inputs{};
+                inputs.flags = IPL_SIMULATIONFLAGS_REFLECTIONS;
+                inputs.source = source->local_state.source_coordinates_cache;
+                set_reflection_inputs_steamaudio(global_state, inputs);
+                iplSourceSetInputs(source->src, IPL_SIMULATIONFLAGS_REFLECTIONS, &inputs);
+            }
+            shared_inputs.numRays = global_state.sim_settings.maxNumRays;
+            shared_inputs.numBounces = global_state.num_bounces;
+            shared_inputs.duration = global_state.sim_settings.maxDuration;
+            shared_inputs.order = global_state.sim_settings.maxOrder;
+            shared_inputs.irradianceMinDistance = 1.0f;
+            iplSimulatorSetSharedInputs(global_state.simulator, IPL_SIMULATIONFLAGS_REFLECTIONS, &shared_inputs);
+            start_usec = ticks_usec_steamaudio();
+            iplSimulatorRunReflections(global_state.simulator);
+            reflections_usec += ticks_usec_steamaudio() - start_usec;
+            num_reflection_passes++;
+            for (ReplaySourceSteamAudio * source : sources) {
+                IndirectOutputsSteamAudio& indirect_outputs = source->local_state.sim_outputs.indirect.write_slot();
+                iplSourceGetOutputs(source->src, IPL_SIMULATIONFLAGS_REFLECTIONS, &(indirect_outputs.indirect_sim_outputs));
+                source->local_state.sim_outputs.indirect.publish(time_usec);
+            }
+            next_reflection_usec = time_usec + reflection_interval_usec;
+        }
+
+        //Mix every block whose start time this tick has reached
+        for (ReplaySourceSteamAudio * source : sources) {
+            source->local_state.sim_outputs.direct.acquire();
+            source->local_state.sim_outputs.indirect.acquire();
+        }
+        uint64_t blocks_due = (time_usec - first_usec) * (uint64_t)mix_rate / (1000000ull * buffer_size) + 1;
+        for (; num_blocks < blocks_due; num_blocks++) {
+            memset(mixed.ptr(), 0, sizeof(AudioFrame) * buffer_size);
+            for (ReplaySourceSteamAudio * source : sources) {
+                AudioFrame * work_buffer = source->local_state.work_buffer;
+                for (unsigned int frame = 0; frame < buffer_size; frame++) {
+                    source->noise = source->noise * 1664525u + 1013904223u;
+                    float sample = ((source->noise >> 8) / 8388608.0f - 1.0f) * 0.25f;
+                    work_buffer[frame] = AudioFrame(sample, sample);
+                }
+                spatialize_steamaudio(global_state, source->local_state, source->effect);
+                for (unsigned int frame = 0; frame < buffer_size; frame++) {
+                    mixed[frame] += work_buffer[frame];
+                }
+            }
+            if (write_wav) {
+                for (unsigned int frame = 0; frame < buffer_size; frame++) {
+                    samples.push_back((int16_t)CLAMP(mixed[frame].l * 32767.0f, -32768.0f, 32767.0f));
+                    samples.push_back((int16_t)CLAMP(mixed[frame].r * 32767.0f, -32768.0f, 32767.0f));
+                }
+            }
+        }
+        num_ticks++;
+    }
+    uint64_t wall_usec = MAX(ticks_usec_steamaudio() - wall_start_usec, (uint64_t)1);
+
+    for (ReplaySourceSteamAudio * source : sources) {
+        release_replay_source_steamaudio(global_state, source);
+    }
+    for (IPLStaticMesh static_mesh : static_meshes) {
+        iplStaticMeshRemove(static_mesh, global_state.scene);
+        iplStaticMeshRelease(&static_mesh);
+    }
+    if (error_code) {
+        iplEmbreeDeviceRelease(&(global_state.embree_device));
+        deinit_global_state_steamaudio(global_state);
+        return error_code;
+    }
+
+    uint64_t spatialize_blocks = 0;
+    for (int bucket = 0; bucket < SPATIALIZE_HISTOGRAM_BUCKETS_STEAMAUDIO; bucket++) {
+        spatialize_blocks += global_state.stats.spatialize_histogram[bucket].load();
+    }
+    double audio_seconds = (double)num_blocks * buffer_size / mix_rate;
+    result["ticks"] = num_ticks;
+    result["blocks"] = num_blocks;
+    result["max_sources"] = max_sources;
+    result["audio_seconds"] = audio_seconds;
+    result["wall_seconds"] = wall_usec / 1000000.0;
+    result["realtime_factor"] = audio_seconds * 1000000.0 / wall_usec;
+    result["direct_msec"] = num_ticks ? direct_usec / 1000.0 / num_ticks : 0.0;
+    result["reflections_msec"] = num_reflection_passes ? reflections_usec / 1000.0 / num_reflection_passes : 0.0;
+    result["spatialize_avg_usec"] = spatialize_blocks ? (double)global_state.stats.spatialize_sum_usec.load() / spatialize_blocks : 0.0;
+
+    //deinit_global_state_steamaudio() leaves the Embree device alone, this one is private to the replay
+    iplEmbreeDeviceRelease(&(global_state.embree_device));
+    deinit_global_state_steamaudio(global_state);
+
+    if (write_wav) {
+        Vector<uint8_t> pcm;
+        pcm.resize(samples.size() * sizeof(int16_t));
+        memcpy(pcm.ptrw(), samples.ptr(), pcm.size());
+        Ref<AudioStreamWAV> wav;
+        wav.instantiate();
+        wav->set_format(AudioStreamWAV::FORMAT_16_BITS);
+        wav->set_stereo(true);
+        wav->set_mix_rate(mix_rate);
+        wav->set_data(pcm);
+        err = wav->save_to_wav(wav_path);
+        if (err != OK) {
+            printf("Err code for save_to_wav: %d\n", err);
+            return (int)err;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_CAPTURE_H
+#define STEAMAUDIO_CAPTURE_H
+
+#include "core/io/file_access.h"
+#include "core/variant/dictionary.h"
+#include "godot_steamaudio.h"
+
+#define CAPTURE_MAGIC_STEAMAUDIO 0x50434153 //"SACP"
+#define CAPTURE_VERSION_STEAMAUDIO 4
+#define CAPTURE_TAG_END_STEAMAUDIO 0
+#define CAPTURE_TAG_TICK_STEAMAUDIO 1
+//Sizes read back from a capture are checked against these and the bytes left in the file before anything is allocated
+#define CAPTURE_MAX_MESH_BYTES_STEAMAUDIO (256ull << 20)
+#define CAPTURE_MAX_SOURCES_STEAMAUDIO 4096
+#define CAPTURE_MAX_BUFFER_SIZE_STEAMAUDIO 16384
+#define CAPTURE_SOURCE_BYTES_STEAMAUDIO 32 //id, position, occlusion radius and samples, reflection type
+
+//Server settings that aren't part of GlobalStateSteamAudio
+struct CaptureSettingsSteamAudio {
+    float direct_rate = 0.0f;
+    float reflection_rate = 0.0f;
+};
+
+struct CaptureSourceSteamAudio {
+    uint64_t id;
+    Vector3 position;
+    float occlusion_radius;
+    int occlusion_num_samples;
+    IPLReflectionEffectType reflection_type;
+};
+
+//File layout, little-endian:
+//  header    magic, version, settings
+//  scene     mesh count, then each static mesh as an iplStaticMeshSave blob with its size
+//  ticks     TICK tag, time, listener pose, source count, sources, repeated until the END tag
+Error begin_capture_steamaudio(GlobalStateSteamAudio& global_state, const CaptureSettingsSteamAudio& settings, const String& path, Ref<FileAccess>& file);
+void capture_tick_steamaudio(Ref<FileAccess>& file, uint64_t time_usec, const IPLCoordinateSpace3& listener, const LocalVector<CaptureSourceSteamAudio>& sources);
+void end_capture_steamaudio(Ref<FileAccess>& file);
+int replay_capture_steamaudio(const String& path, const String& wav_path, Dictionary& result);
+
+#endif // STEAMAUDIO_CAPTURE_H
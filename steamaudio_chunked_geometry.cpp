@@ -0,0 +1,222 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_chunked_geometry.h"
+#include "core/config/engine.h"
+#include "modules/modules_enabled.gen.h"
+
+#ifdef MODULE_CSG_ENABLED
+#include "modules/csg/csg_shape.h"
+#endif
+
+SteamAudioChunkedGeometry::SteamAudioChunkedGeometry() {
+    global_state = SteamAudioServer::get_singleton()->clone_global_state();
+}
+
+SteamAudioChunkedGeometry::~SteamAudioChunkedGeometry() {
+    clear();
+}
+
+void SteamAudioChunkedGeometry::collect_mesh(const Ref<Mesh>& mesh, const Transform3D& xform, LocalVector<MeshDataSteamAudio>& chunks, HashMap<Vector3i, int>& chunk_lookup) {
+    if (mesh.is_null()) {
+        return;
+    }
+    for (int sidx = 0; sidx < mesh->get_surface_count(); sidx++) {
+        if (mesh->surface_get_primitive_type(sidx) != Mesh::PRIMITIVE_TRIANGLES) {
+            continue;
+        }
+        //Bring the surface into world space once, then bin its triangles by centroid
+        MeshDataSteamAudio surface;
+        int n_tris = append_surface_steamaudio(mesh->surface_get_arrays(sidx), xform, surface);
+        if (n_tris == 0) {
+            continue;
+        }
+        const IPLVector3 * verts = surface.verts.ptr();
+        const IPLTriangle * tris = surface.triangles.ptr();
+
+        //A vertex shared across a chunk boundary is simply duplicated into each chunk
+        LocalVector<int32_t> remap_vertex;
+        LocalVector<int32_t> remap_chunk;
+        remap_vertex.resize(surface.verts.size());
+        remap_chunk.resize(surface.verts.size());
+        remap_chunk.fill(-1);
+
+        for (int tidx = 0; tidx < n_tris; tidx++) {
+            Vector3 centroid;
+            for (int corner = 0; corner < 3; corner++) {
+                centroid += IPLVec3toGDVec3(verts[tris[tidx].indices[corner]]);
+            }
+            centroid = (centroid / 3.0f) / chunk_size;
+            Vector3i cell = Vector3i((int)Math::floor(centroid.x), (int)Math::floor(centroid.y), (int)Math::floor(centroid.z));
+
+            int chunk_idx;
+            int * existing = chunk_lookup.getptr(cell);
+            if (existing) {
+                chunk_idx = *existing;
+            } else {
+                chunk_idx = chunks.size();
+                chunks.push_back(MeshDataSteamAudio());
+                chunk_lookup.insert(cell, chunk_idx);
+            }
+            MeshDataSteamAudio& chunk = chunks[chunk_idx];
+
+            IPLTriangle tri;
+            for (int corner = 0; corner < 3; corner++) {
+                int vidx = tris[tidx].indices[corner];
+                if (remap_chunk[vidx] != chunk_idx) {
+                    remap_chunk[vidx] = chunk_idx;
+                    remap_vertex[vidx] = chunk.verts.size();
+                    chunk.verts.push_back(verts[vidx]);
+                }
+                tri.indices[corner] = remap_vertex[vidx];
+            }
+            chunk.triangles.push_back(tri);
+            chunk.material_indices.push_back(0);
+        }
+    }
+}
+
+void SteamAudioChunkedGeometry::collect_node(Node * node, LocalVector<MeshDataSteamAudio>& chunks, HashMap<Vector3i, int>& chunk_lookup) {
+    MeshInstance3D * mesh_instance = Object::cast_to<MeshInstance3D>(node);
+    if (mesh_instance) {
+        collect_mesh(mesh_instance->get_mesh(), mesh_instance->get_global_transform(), chunks, chunk_lookup);
+    }
+#ifdef MODULE_CSG_ENABLED
+    //Only the root of a CSG tree holds the combined mesh
+    CSGShape3D * csg_shape = Object::cast_to<CSGShape3D>(node);
+    if (csg_shape && csg_shape->is_root_shape()) {
+        Array csg_meshes = csg_shape->get_meshes();
+        if (csg_meshes.size() == 2) {
+            Transform3D csg_xform = csg_meshes[0];
+            collect_mesh(csg_meshes[1], csg_shape->get_global_transform() * csg_xform, chunks, chunk_lookup);
+        }
+    }
+#endif
+    for (int cidx = 0; cidx < node->get_child_count(); cidx++) {
+        collect_node(node->get_child(cidx), chunks, chunk_lookup);
+    }
+}
+
+int SteamAudioChunkedGeometry::harvest() {
+    ERR_FAIL_COND_V(!is_inside_tree(), -1);
+    ERR_FAIL_COND_V(chunk_size <= 0.0f, -1);
+    clear();
+
+    Node * source = source_path.is_empty() ? this : get_node_or_null(source_path);
+    ERR_FAIL_NULL_V(source, -1);
+
+    LocalVector<MeshDataSteamAudio> chunks;
+    HashMap<Vector3i, int> chunk_lookup;
+    collect_node(source, chunks, chunk_lookup);
+
+    for (uint32_t chunk_idx = 0; chunk_idx < chunks.size(); chunk_idx++) {
+        IPLStaticMesh static_mesh = nullptr;
+        int error_code = create_static_mesh_steamaudio(*global_state, global_state->scene, chunks[chunk_idx], &static_mesh);
+        if (error_code) {
+            return error_code;
+        }
+        if (static_mesh == nullptr) {
+            continue;
+        }
+        triangle_count += chunks[chunk_idx].triangles.size();
+        static_meshes.push_back(static_mesh);
+        add_scene_static_mesh_steamaudio(*global_state, static_mesh);
+    }
+    return 0;
+}
+
+void SteamAudioChunkedGeometry::clear() {
+    for (int midx = 0; midx < static_meshes.size(); midx++) {
+        IPLStaticMesh mesh_ptr = static_meshes.get(midx);
+        remove_scene_static_mesh_steamaudio(*global_state, mesh_ptr);
+        iplStaticMeshRelease(&mesh_ptr);
+    }
+    static_meshes.clear();
+    triangle_count = 0;
+}
+
+void SteamAudioChunkedGeometry::set_source_path(const NodePath& p_path) {
+    source_path = p_path;
+}
+
+NodePath SteamAudioChunkedGeometry::get_source_path() const {
+    return source_path;
+}
+
+void SteamAudioChunkedGeometry::set_chunk_size(float p_size) {
+    ERR_FAIL_COND(p_size <= 0.0f);
+    chunk_size = p_size;
+}
+
+float SteamAudioChunkedGeometry::get_chunk_size() const {
+    return chunk_size;
+}
+
+void SteamAudioChunkedGeometry::set_harvest_on_enter(bool p_enable) {
+    harvest_on_enter = p_enable;
+}
+
+bool SteamAudioChunkedGeometry::is_harvest_on_enter() const {
+    return harvest_on_enter;
+}
+
+int SteamAudioChunkedGeometry::get_chunk_count() const {
+    return static_meshes.size();
+}
+
+int SteamAudioChunkedGeometry::get_triangle_count() const {
+    return triangle_count;
+}
+
+void SteamAudioChunkedGeometry::_notification(int p_what) {
+    switch (p_what) {
+        case NOTIFICATION_ENTER_TREE: {
+            //Deferred so CSG roots have built their meshes first
+            if (harvest_on_enter && !Engine::get_singleton()->is_editor_hint()) {
+                callable_mp(this, &SteamAudioChunkedGeometry::harvest).call_deferred();
+            }
+        } break;
+
+        case NOTIFICATION_EXIT_TREE: {
+            clear();
+        } break;
+    }
+}
+
+void SteamAudioChunkedGeometry::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("harvest"), &SteamAudioChunkedGeometry::harvest);
+	ClassDB::bind_method(D_METHOD("clear"), &SteamAudioChunkedGeometry::clear);
+	ClassDB::bind_method(D_METHOD("set_source_path", "path"), &SteamAudioChunkedGeometry::set_source_path);
+	ClassDB::bind_method(D_METHOD("get_source_path"), &SteamAudioChunkedGeometry::get_source_path);
+	ClassDB::bind_method(D_METHOD("set_chunk_size", "size"), &SteamAudioChunkedGeometry::set_chunk_size);
+	ClassDB::bind_method(D_METHOD("get_chunk_size"), &SteamAudioChunkedGeometry::get_chunk_size);
+	ClassDB::bind_method(D_METHOD("set_harvest_on_enter", "enable"), &SteamAudioChunkedGeometry::set_harvest_on_enter);
+	ClassDB::bind_method(D_METHOD("is_harvest_on_enter"), &SteamAudioChunkedGeometry::is_harvest_on_enter);
+	ClassDB::bind_method(D_METHOD("get_chunk_count"), &SteamAudioChunkedGeometry::get_chunk_count);
+	ClassDB::bind_method(D_METHOD("get_triangle_count"), &SteamAudioChunkedGeometry::get_triangle_count);
+
+	ADD_PROPERTY(PropertyInfo(Variant::NODE_PATH, "source_path"), "set_source_path", "get_source_path");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "chunk_size", PROPERTY_HINT_RANGE, "0.5,256,0.5,or_greater,suffix:m"), "set_chunk_size", "get_chunk_size");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "harvest_on_enter"), "set_harvest_on_enter", "is_harvest_on_enter");
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_CHUNKED_GEOMETRY_H
+#define STEAMAUDIO_CHUNKED_GEOMETRY_H
+
+#include "scene/3d/node_3d.h"
+#include "steamaudio_geometry.h"
+
+class SteamAudioChunkedGeometry : public Node3D {
+    GDCLASS(SteamAudioChunkedGeometry, Node3D);
+public:
+    SteamAudioChunkedGeometry();
+    ~SteamAudioChunkedGeometry();
+    int harvest();
+    void clear();
+    void set_source_path(const NodePath& p_path);
+    NodePath get_source_path() const;
+    void set_chunk_size(float p_size);
+    float get_chunk_size() const;
+    void set_harvest_on_enter(bool p_enable);
+    bool is_harvest_on_enter() const;
+    int get_chunk_count() const;
+    int get_triangle_count() const;
+protected:
+    void _notification(int p_what);
+    static void _bind_methods();
+private:
+    GlobalStateSteamAudio * global_state = nullptr;
+    NodePath source_path;
+    float chunk_size = 16.0f;
+    bool harvest_on_enter = true;
+    int triangle_count = 0;
+    Vector<IPLStaticMesh> static_meshes;
+    void collect_node(Node * node, LocalVector<MeshDataSteamAudio>& chunks, HashMap<Vector3i, int>& chunk_lookup);
+    void collect_mesh(const Ref<Mesh>& mesh, const Transform3D& xform, LocalVector<MeshDataSteamAudio>& chunks, HashMap<Vector3i, int>& chunk_lookup);
+};
+
+
+#endif // STEAMAUDIO_CHUNKED_GEOMETRY_H
@@ -23,6 +23,19 @@ SOFTWARE.
 ******************************************************************************/
 
 #include "steamaudio_geometry.h"
+#include "steamaudio_memory.h"
+#include "core/crypto/crypto_core.h"
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/os/os.h"
+#include "core/templates/hash_map.h"
+#include "scene/resources/surface_tool.h"
+#include <mutex>
+
+#if defined(__SSE__) && !defined(REAL_T_IS_DOUBLE)
+#include <xmmintrin.h>
+#define STEAMAUDIO_GEOMETRY_SSE
+#endif
 
 SteamAudioGeometry::SteamAudioGeometry() {
     global_state = SteamAudioServer::get_singleton()->clone_global_state();
@@ -33,71 +46,602 @@ SteamAudioGeometry::~SteamAudioGeometry() {
     destroy_geometry();
 }
 
-int SteamAudioGeometry::create_geometry(const Ref<Mesh> mesh, Transform3D mesh_global_transform) {
+void transform_vertices_steamaudio(const Vector3 * verts_in, IPLVector3 * verts_out, int n_verts, const Transform3D& xform) {
+#if defined(STEAMAUDIO_GEOMETRY_SSE)
+    //Broadcast each component against the basis columns, four lanes wide with the last lane unused
+    const Basis& basis = xform.basis;
+    const __m128 col_x = _mm_setr_ps(basis.rows[0][0], basis.rows[1][0], basis.rows[2][0], 0.0f);
+    const __m128 col_y = _mm_setr_ps(basis.rows[0][1], basis.rows[1][1], basis.rows[2][1], 0.0f);
+    const __m128 col_z = _mm_setr_ps(basis.rows[0][2], basis.rows[1][2], basis.rows[2][2], 0.0f);
+    const __m128 origin = _mm_setr_ps(xform.origin.x, xform.origin.y, xform.origin.z, 0.0f);
+    for (int vidx = 0; vidx < n_verts; vidx++) {
+        __m128 vert = _mm_add_ps(origin, _mm_mul_ps(col_x, _mm_set1_ps(verts_in[vidx].x)));
+        vert = _mm_add_ps(vert, _mm_mul_ps(col_y, _mm_set1_ps(verts_in[vidx].y)));
+        vert = _mm_add_ps(vert, _mm_mul_ps(col_z, _mm_set1_ps(verts_in[vidx].z)));
+        //IPLVector3 is only three floats wide, so store x/y and z separately
+        _mm_storel_pi((__m64 *)&(verts_out[vidx].x), vert);
+        _mm_store_ss(&(verts_out[vidx].z), _mm_movehl_ps(vert, vert));
+    }
+#else
+    for (int vidx = 0; vidx < n_verts; vidx++) {
+        verts_out[vidx] = GDVec3toIPLVec3(xform.xform(verts_in[vidx]));
+    }
+#endif
+}
+
+int append_surface_steamaudio(const PackedVector3Array& verts_gd, const PackedInt32Array& indices_gd, const Transform3D& xform, MeshDataSteamAudio& mesh_data) {
+    bool indexed = !indices_gd.is_empty();
+    int n_verts = verts_gd.size();
+    int n_tris = (indexed ? indices_gd.size() : n_verts) / 3;
+    if (n_verts == 0 || n_tris == 0) {
+        return 0;
+    }
+
+    int vert_offset = mesh_data.verts.size();
+    int tri_offset = mesh_data.triangles.size();
+    mesh_data.verts.resize(vert_offset + n_verts);
+    mesh_data.triangles.resize(tri_offset + n_tris);
+    mesh_data.material_indices.resize(tri_offset + n_tris);
+
+    transform_vertices_steamaudio(verts_gd.ptr(), mesh_data.verts.ptrw() + vert_offset, n_verts, xform);
+
+    //Convert Godot CW to SteamAudio CCW
+    IPLTriangle * tris = mesh_data.triangles.ptrw() + tri_offset;
+    if (indexed) {
+        const int32_t * indices = indices_gd.ptr();
+        for (int tidx = 0; tidx < n_tris; tidx++) {
+            tris[tidx].indices[0] = vert_offset + indices[3*tidx];
+            tris[tidx].indices[1] = vert_offset + indices[3*tidx+2];
+            tris[tidx].indices[2] = vert_offset + indices[3*tidx+1];
+        }
+    } else {
+        for (int tidx = 0; tidx < n_tris; tidx++) {
+            tris[tidx].indices[0] = vert_offset + 3*tidx;
+            tris[tidx].indices[1] = vert_offset + 3*tidx+2;
+            tris[tidx].indices[2] = vert_offset + 3*tidx+1;
+        }
+    }
+    memset(mesh_data.material_indices.ptrw() + tri_offset, 0, sizeof(IPLint32)*n_tris);
+
+    return n_tris;
+}
+
+int append_surface_steamaudio(const Array& surface_data, const Transform3D& xform, MeshDataSteamAudio& mesh_data) {
+    if (surface_data.size() != Mesh::ARRAY_MAX) {
+        return 0;
+    }
+    //Packed arrays are copy-on-write, so these share the surface data instead of converting each element
+    const PackedVector3Array verts_gd = surface_data[Mesh::ARRAY_VERTEX];
+    const PackedInt32Array indices_gd = surface_data[Mesh::ARRAY_INDEX];
+    return append_surface_steamaudio(verts_gd, indices_gd, xform, mesh_data);
+}
+
+static IPLMaterial default_material_steamaudio() {
+    return *default_ipl_material_steamaudio();
+}
+
+static uint32_t find_component_steamaudio(LocalVector<uint32_t>& parent, uint32_t vidx) {
+    while (parent[vidx] != vidx) {
+        parent[vidx] = parent[parent[vidx]];
+        vidx = parent[vidx];
+    }
+    return vidx;
+}
+
+//Meshes only carry a single material for now, so every output triangle uses material 0
+int simplify_mesh_data_steamaudio(MeshDataSteamAudio& mesh_data, float tolerance, float min_feature_size) {
+    int n_tris_in = mesh_data.triangles.size();
+    if (n_tris_in == 0) {
+        return 0;
+    }
+
+    //Render meshes split vertices along UV and normal seams, weld by position so edges can collapse across them
+    HashMap<Vector3, uint32_t> weld_lookup;
+    LocalVector<IPLVector3> positions;
+    LocalVector<uint32_t> weld_remap;
+    weld_remap.resize(mesh_data.verts.size());
+    const IPLVector3 * verts = mesh_data.verts.ptr();
+    for (int vidx = 0; vidx < mesh_data.verts.size(); vidx++) {
+        Vector3 pos = IPLVec3toGDVec3(verts[vidx]);
+        uint32_t * existing = weld_lookup.getptr(pos);
+        if (existing) {
+            weld_remap[vidx] = *existing;
+        } else {
+            weld_remap[vidx] = positions.size();
+            weld_lookup.insert(pos, positions.size());
+            positions.push_back(verts[vidx]);
+        }
+    }
+    LocalVector<uint32_t> indices;
+    indices.resize(n_tris_in*3);
+    const IPLTriangle * tris = mesh_data.triangles.ptr();
+    for (int tidx = 0; tidx < n_tris_in; tidx++) {
+        for (int corner = 0; corner < 3; corner++) {
+            indices[3*tidx+corner] = weld_remap[tris[tidx].indices[corner]];
+        }
+    }
+
+    //Quadric edge collapse, coplanar regions collapse at zero error so they merge first
+    if (tolerance > 0.0f && SurfaceTool::simplify_func != nullptr) {
+        float mesh_scale = 1.0f;
+        if (SurfaceTool::simplify_scale_func != nullptr) {
+            mesh_scale = SurfaceTool::simplify_scale_func((const float *)positions.ptr(), positions.size(), sizeof(IPLVector3));
+        }
+        LocalVector<uint32_t> simplified;
+        simplified.resize(indices.size());
+        float result_error = 0.0f;
+        size_t n_indices = SurfaceTool::simplify_func(simplified.ptr(), indices.ptr(), indices.size(),
+                                                      (const float *)positions.ptr(), positions.size(), sizeof(IPLVector3),
+                                                      0, tolerance / MAX(mesh_scale, 1e-6f), 0, &result_error);
+        simplified.resize(n_indices);
+        indices = simplified;
+    }
+
+    //Drop connected pieces whose bounds are below the feature size
+    LocalVector<uint8_t> keep_vertex;
+    keep_vertex.resize(positions.size());
+    keep_vertex.fill(1);
+    if (min_feature_size > 0.0f) {
+        LocalVector<uint32_t> parent;
+        parent.resize(positions.size());
+        for (uint32_t vidx = 0; vidx < positions.size(); vidx++) {
+            parent[vidx] = vidx;
+        }
+        for (uint32_t iidx = 0; iidx < indices.size(); iidx += 3) {
+            uint32_t root_a = find_component_steamaudio(parent, indices[iidx]);
+            for (int corner = 1; corner < 3; corner++) {
+                uint32_t root_b = find_component_steamaudio(parent, indices[iidx+corner]);
+                if (root_a != root_b) {
+                    parent[root_b] = root_a;
+                }
+            }
+        }
+        LocalVector<AABB> component_bounds;
+        component_bounds.resize(positions.size());
+        LocalVector<uint8_t> component_seen;
+        component_seen.resize(positions.size());
+        component_seen.fill(0);
+        for (uint32_t vidx = 0; vidx < positions.size(); vidx++) {
+            uint32_t root = find_component_steamaudio(parent, vidx);
+            Vector3 pos = IPLVec3toGDVec3(positions[vidx]);
+            if (!component_seen[root]) {
+                component_seen[root] = 1;
+                component_bounds[root] = AABB(pos, Vector3());
+            } else {
+                component_bounds[root].expand_to(pos);
+            }
+        }
+        for (uint32_t vidx = 0; vidx < positions.size(); vidx++) {
+            uint32_t root = find_component_steamaudio(parent, vidx);
+            keep_vertex[vidx] = component_bounds[root].get_longest_axis_size() >= min_feature_size;
+        }
+    }
+
+    //Rebuild with only the vertices still referenced
+    LocalVector<int32_t> compact_remap;
+    compact_remap.resize(positions.size());
+    compact_remap.fill(-1);
+    mesh_data.verts.clear();
+    mesh_data.triangles.clear();
+    for (uint32_t iidx = 0; iidx + 2 < indices.size(); iidx += 3) {
+        if (!keep_vertex[indices[iidx]]) {
+            continue;
+        }
+        IPLTriangle tri;
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vidx = indices[iidx+corner];
+            if (compact_remap[vidx] < 0) {
+                compact_remap[vidx] = mesh_data.verts.size();
+                mesh_data.verts.push_back(positions[vidx]);
+            }
+            tri.indices[corner] = compact_remap[vidx];
+        }
+        mesh_data.triangles.push_back(tri);
+    }
+    mesh_data.material_indices.resize(mesh_data.triangles.size());
+    memset(mesh_data.material_indices.ptrw(), 0, sizeof(IPLint32)*mesh_data.triangles.size());
+
+    return mesh_data.triangles.size();
+}
+
+int create_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, IPLScene scene, MeshDataSteamAudio& mesh_data, IPLStaticMesh * static_mesh) {
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SCENE_STEAMAUDIO);
+    IPLMaterial default_replace_me = default_material_steamaudio();
+    *static_mesh = nullptr;
+    if (global_state.scene_settings.type == IPL_SCENETYPE_CUSTOM) {
+        //The physics world is the geometry, there is nothing to build
+        return 0;
+    }
+
+    int n_tris_in = mesh_data.triangles.size();
+    if (global_state.simplify_geometry) {
+        simplify_mesh_data_steamaudio(mesh_data, global_state.simplify_tolerance, global_state.simplify_min_feature_size);
+        print_verbose(vformat("Steam Audio mesh simplified from %d to %d triangles", n_tris_in, mesh_data.triangles.size()));
+    }
+    global_state.geometry_triangles_in += n_tris_in;
+    global_state.geometry_triangles_out += mesh_data.triangles.size();
+    if (mesh_data.triangles.is_empty()) {
+        return 0;
+    }
+
+    IPLStaticMeshSettings static_mesh_settings{};
+    static_mesh_settings.numVertices = mesh_data.verts.size();
+    static_mesh_settings.numTriangles = mesh_data.triangles.size();
+    static_mesh_settings.numMaterials = 1;
+    static_mesh_settings.vertices = mesh_data.verts.ptrw();
+    static_mesh_settings.triangles = mesh_data.triangles.ptrw();
+    static_mesh_settings.materialIndices = mesh_data.material_indices.ptrw();
+    static_mesh_settings.materials = &default_replace_me;
+    IPLerror errorCode = iplStaticMeshCreate(scene, &static_mesh_settings, static_mesh);
+    if (errorCode) {
+        printf("Err code for iplStaticMeshCreate: %d\n", errorCode);
+        return (int)errorCode;
+    }
+    return 0;
+}
+
+//Bump when the cache file layout changes, old entries then miss and age out
+#define MESH_CACHE_FORMAT_STEAMAUDIO 2
+
+String mesh_cache_key_steamaudio(const GlobalStateSteamAudio& global_state, const PackedVector3Array& verts_gd, const PackedInt32Array& indices_gd, const Transform3D& xform, const IPLMaterial& material) {
+    CryptoCore::SHA256Context ctx;
+    ctx.start();
+    uint32_t version[2] = { STEAMAUDIO_VERSION, MESH_CACHE_FORMAT_STEAMAUDIO };
+    ctx.update((const uint8_t *)version, sizeof(version));
+    ctx.update((const uint8_t *)verts_gd.ptr(), sizeof(Vector3)*verts_gd.size());
+    ctx.update((const uint8_t *)indices_gd.ptr(), sizeof(int32_t)*indices_gd.size());
+    ctx.update((const uint8_t *)&xform, sizeof(Transform3D));
+    ctx.update((const uint8_t *)&material, sizeof(IPLMaterial));
+    if (global_state.simplify_geometry) {
+        float simplify_params[2] = { global_state.simplify_tolerance, global_state.simplify_min_feature_size };
+        ctx.update((const uint8_t *)simplify_params, sizeof(simplify_params));
+    }
+    unsigned char hash[32];
+    ctx.finish(hash);
+    return String::hex_encode_buffer(hash, 32);
+}
+
+//Size and last use of every cache entry, keyed by file name. The directory is scanned once, entries from earlier
+//runs start at their file time, after that saves keep the total up to date without touching the disk.
+//Geometry is built on the main and geometry threads, so both go through the mutex
+static std::mutex mesh_cache_mtx;
+static String mesh_cache_scanned_path;
+static HashMap<String, uint64_t> mesh_cache_last_use;
+static HashMap<String, uint64_t> mesh_cache_sizes;
+static uint64_t mesh_cache_total_size = 0;
+
+struct MeshCacheEntrySteamAudio {
+    String file;
+    uint64_t last_use = 0;
+    uint64_t size = 0;
+};
+
+struct MeshCacheEntryOlderSteamAudio {
+    bool operator()(const MeshCacheEntrySteamAudio& a, const MeshCacheEntrySteamAudio& b) const {
+        return a.last_use < b.last_use;
+    }
+};
+
+//Caller holds mesh_cache_mtx. Files left over from interrupted writes are removed here
+static void scan_mesh_cache_steamaudio(const GlobalStateSteamAudio& global_state) {
+    if (mesh_cache_scanned_path == global_state.mesh_cache_path) {
+        return;
+    }
+    mesh_cache_scanned_path = global_state.mesh_cache_path;
+    mesh_cache_last_use.clear();
+    mesh_cache_sizes.clear();
+    mesh_cache_total_size = 0;
+    Ref<DirAccess> dir = DirAccess::open(global_state.mesh_cache_path);
+    if (dir.is_null()) {
+        return;
+    }
+    Vector<String> stale_files;
+    dir->list_dir_begin();
+    for (String file = dir->get_next(); !file.is_empty(); file = dir->get_next()) {
+        if (dir->current_is_dir()) {
+            continue;
+        }
+        if (file.ends_with(".iplmesh.tmp")) {
+            stale_files.push_back(file);
+            continue;
+        }
+        if (!file.ends_with(".iplmesh")) {
+            continue;
+        }
+        String path = global_state.mesh_cache_path.path_join(file);
+        Ref<FileAccess> f = FileAccess::open(path, FileAccess::READ);
+        if (f.is_null()) {
+            continue;
+        }
+        mesh_cache_sizes[file] = f->get_length();
+        mesh_cache_last_use[file] = FileAccess::get_modified_time(path);
+        mesh_cache_total_size += f->get_length();
+    }
+    dir->list_dir_end();
+    for (const String& file : stale_files) {
+        dir->remove(file);
+    }
+}
+
+static void touch_mesh_cache_entry_steamaudio(const GlobalStateSteamAudio& global_state, const String& file) {
+    std::unique_lock<std::mutex> lock(mesh_cache_mtx);
+    scan_mesh_cache_steamaudio(global_state);
+    mesh_cache_last_use[file] = (uint64_t)OS::get_singleton()->get_unix_time();
+}
+
+//Evicts the least recently used entries until the cache fits in mesh_cache_max_size.
+//Works from the in-memory sizes, the disk is only touched to remove files
+int trim_mesh_cache_steamaudio(const GlobalStateSteamAudio& global_state) {
+    if (global_state.mesh_cache_max_size == 0) {
+        return 0;
+    }
+    std::unique_lock<std::mutex> lock(mesh_cache_mtx);
+    scan_mesh_cache_steamaudio(global_state);
+    if (mesh_cache_total_size <= global_state.mesh_cache_max_size) {
+        return 0;
+    }
+    Ref<DirAccess> dir = DirAccess::open(global_state.mesh_cache_path);
+    if (dir.is_null()) {
+        return -1;
+    }
+    Vector<MeshCacheEntrySteamAudio> entries;
+    for (const KeyValue<String, uint64_t>& size : mesh_cache_sizes) {
+        MeshCacheEntrySteamAudio entry;
+        entry.file = size.key;
+        entry.size = size.value;
+        const uint64_t * last_use = mesh_cache_last_use.getptr(size.key);
+        entry.last_use = last_use ? *last_use : 0;
+        entries.push_back(entry);
+    }
+
+    entries.sort_custom<MeshCacheEntryOlderSteamAudio>();
+    for (int eidx = 0; eidx < entries.size() && mesh_cache_total_size > global_state.mesh_cache_max_size; eidx++) {
+        //A file that is already gone only leaves the books
+        if (dir->remove(entries[eidx].file) != OK && FileAccess::exists(global_state.mesh_cache_path.path_join(entries[eidx].file))) {
+            continue;
+        }
+        mesh_cache_total_size -= entries[eidx].size;
+        mesh_cache_sizes.erase(entries[eidx].file);
+        mesh_cache_last_use.erase(entries[eidx].file);
+    }
+    return 0;
+}
+
+int load_cached_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, IPLScene scene, const String& key, IPLStaticMesh * static_mesh) {
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SCENE_STEAMAUDIO);
+    String path = global_state.mesh_cache_path.path_join(key + ".iplmesh");
+    if (!FileAccess::exists(path)) {
+        return -1;
+    }
+    Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ);
+    if (file.is_null()) {
+        return -1;
+    }
+    //Triangle counts lead the serialized mesh so the geometry stats stay right on a cache hit
+    if (file->get_length() <= 2*sizeof(uint32_t)) {
+        return -1;
+    }
+    uint32_t n_tris_in = file->get_32();
+    uint32_t n_tris_out = file->get_32();
+    PackedByteArray data;
+    data.resize(file->get_length() - 2*sizeof(uint32_t));
+    if (file->get_buffer(data.ptrw(), data.size()) != (uint64_t)data.size()) {
+        return -1;
+    }
+
+    IPLSerializedObjectSettings serialized_settings{};
+    serialized_settings.data = data.ptrw();
+    serialized_settings.size = data.size();
+    IPLSerializedObject serialized_object = nullptr;
+    IPLerror errorCode = iplSerializedObjectCreate(global_state.phonon_ctx, &serialized_settings, &serialized_object);
+    if (errorCode) {
+        printf("Err code for iplSerializedObjectCreate: %d\n", errorCode);
+        return (int)errorCode;
+    }
+    *static_mesh = nullptr;
+    errorCode = iplStaticMeshLoad(scene, serialized_object, nullptr, nullptr, static_mesh);
+    iplSerializedObjectRelease(&serialized_object);
+    if (errorCode) {
+        printf("Err code for iplStaticMeshLoad: %d\n", errorCode);
+        return (int)errorCode;
+    }
+    global_state.geometry_triangles_in += n_tris_in;
+    global_state.geometry_triangles_out += n_tris_out;
+    touch_mesh_cache_entry_steamaudio(global_state, key + ".iplmesh");
+    return 0;
+}
+
+int save_cached_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, const String& key, IPLStaticMesh static_mesh, uint32_t n_tris_in, uint32_t n_tris_out) {
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SCENE_STEAMAUDIO);
+    IPLSerializedObjectSettings serialized_settings{};
+    IPLSerializedObject serialized_object = nullptr;
+    IPLerror errorCode = iplSerializedObjectCreate(global_state.phonon_ctx, &serialized_settings, &serialized_object);
+    if (errorCode) {
+        printf("Err code for iplSerializedObjectCreate: %d\n", errorCode);
+        return (int)errorCode;
+    }
+    iplStaticMeshSave(static_mesh, serialized_object);
+
+    //res:// is read-only in exported projects, so a failed write only means no caching.
+    //The entry is written next to its final name and renamed into place, an interrupted write never leaves a truncated .iplmesh
+    String file_name = key + ".iplmesh";
+    String path = global_state.mesh_cache_path.path_join(file_name);
+    uint64_t size = 2*sizeof(uint32_t) + iplSerializedObjectGetSize(serialized_object);
+    Ref<FileAccess> file = FileAccess::open(path + ".tmp", FileAccess::WRITE);
+    bool written = file.is_valid();
+    if (written) {
+        file->store_32(n_tris_in);
+        file->store_32(n_tris_out);
+        file->store_buffer(iplSerializedObjectGetData(serialized_object), iplSerializedObjectGetSize(serialized_object));
+        written = file->get_error() == OK;
+        file.unref();
+    }
+    iplSerializedObjectRelease(&serialized_object);
+    Ref<DirAccess> dir = DirAccess::open(global_state.mesh_cache_path);
+    if (dir.is_null()) {
+        return -1;
+    }
+    if (!written || dir->rename(file_name + ".tmp", file_name) != OK) {
+        dir->remove(file_name + ".tmp");
+        return -1;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mesh_cache_mtx);
+        scan_mesh_cache_steamaudio(global_state);
+        const uint64_t * old_size = mesh_cache_sizes.getptr(file_name);
+        mesh_cache_total_size += size - (old_size ? *old_size : 0);
+        mesh_cache_sizes[file_name] = size;
+        mesh_cache_last_use[file_name] = (uint64_t)OS::get_singleton()->get_unix_time();
+    }
+    return trim_mesh_cache_steamaudio(global_state);
+}
+
+int create_surface_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, IPLScene scene, const PackedVector3Array& verts_gd, const PackedInt32Array& indices_gd, const Transform3D& xform, IPLStaticMesh * static_mesh) {
+    *static_mesh = nullptr;
+    if (verts_gd.is_empty() || global_state.scene_settings.type == IPL_SCENETYPE_CUSTOM) {
+        return 0;
+    }
+
+    String key;
+    if (global_state.use_mesh_cache) {
+        key = mesh_cache_key_steamaudio(global_state, verts_gd, indices_gd, xform, default_material_steamaudio());
+        if (load_cached_static_mesh_steamaudio(global_state, scene, key, static_mesh) == 0) {
+            return 0;
+        }
+    }
+
+    MeshDataSteamAudio mesh_data;
+    if (append_surface_steamaudio(verts_gd, indices_gd, xform, mesh_data) == 0) {
+        return 0;
+    }
+    uint32_t n_tris_in = mesh_data.triangles.size();
+    int error_code = create_static_mesh_steamaudio(global_state, scene, mesh_data, static_mesh);
+    if (error_code) {
+        return error_code;
+    }
+
+    if (global_state.use_mesh_cache && *static_mesh != nullptr) {
+        //mesh_data holds the simplified triangles by now
+        save_cached_static_mesh_steamaudio(global_state, key, *static_mesh, n_tris_in, mesh_data.triangles.size());
+    }
+    return 0;
+}
+
+//Runs on the server's geometry thread, only touches the snapshot held by the job
+int build_geometry_job_steamaudio(GlobalStateSteamAudio& global_state, GeometryJobSteamAudio * job) {
+    for (int sidx = 0; sidx < job->surface_verts.size(); sidx++) {
+        IPLStaticMesh static_mesh = nullptr;
+        job->error_code = create_surface_static_mesh_steamaudio(global_state, global_state.scene, job->surface_verts[sidx], job->surface_indices[sidx], job->xform, &static_mesh);
+        if (job->error_code) {
+            printf("Err code for build_geometry_job_steamaudio: %d\n", job->error_code);
+            //Don't commit half a mesh, the owner gets geometry_failed instead
+            for (int midx = 0; midx < job->static_meshes.size(); midx++) {
+                IPLStaticMesh mesh_ptr = job->static_meshes[midx];
+                iplStaticMeshRelease(&mesh_ptr);
+            }
+            job->static_meshes.clear();
+            return job->error_code;
+        }
+        if (static_mesh == nullptr) {
+            continue;
+        }
+        job->static_meshes.push_back(static_mesh);
+    }
+    return 0;
+}
+
+int create_mesh_static_meshes_steamaudio(GlobalStateSteamAudio& global_state, IPLScene scene, const Ref<Mesh>& mesh, const Transform3D& xform, Vector<IPLStaticMesh>& static_meshes) {
     int n_surfaces = mesh->get_surface_count();
-    IPLMaterial default_replace_me;
-    default_replace_me.absorption[0] = 0.10f;
-    default_replace_me.absorption[1] = 0.20f;
-    default_replace_me.absorption[2] = 0.30f;
-    default_replace_me.scattering = 0.05f;
-    default_replace_me.transmission[0] = 0.100f;
-    default_replace_me.transmission[1] = 0.050f;
-    default_replace_me.transmission[2] = 0.030f;
-     
     for (int sidx = 0; sidx < n_surfaces; sidx++) {
+        if (mesh->surface_get_primitive_type(sidx) != Mesh::PRIMITIVE_TRIANGLES) {
+            continue;
+        }
         Array surface_data = mesh->surface_get_arrays(sidx);
-        Array verts_gd = surface_data[Mesh::ARRAY_VERTEX];
-        Array triangles_gd = surface_data[Mesh::ARRAY_INDEX];
-        Vector<IPLVector3> verts;
-        Vector<IPLTriangle> triangles;
-        Vector<IPLint32> material_indices;
-        verts.resize(verts_gd.size());
-        for (int vidx = 0; vidx < verts_gd.size(); vidx++) {
-            IPLVector3 vert;
-            Vector3 vert_gd = verts_gd[vidx];
-            vert_gd = mesh_global_transform.basis.xform(vert_gd);
-            vert_gd += mesh_global_transform.origin;
-            vert.x = vert_gd.x;
-            vert.y = vert_gd.y;
-            vert.z = vert_gd.z;
-            
-            verts.set(vidx, vert);
-
-        }
-        for (int tidx = 0; tidx < triangles_gd.size(); tidx+=3) {
-            IPLTriangle tri;
-            //Convert Godot CW to SteamAudio CCW
-            tri.indices[0] = triangles_gd[tidx];
-            tri.indices[1] = triangles_gd[tidx+2];
-            tri.indices[2] = triangles_gd[tidx+1];
-            triangles.push_back(tri);
-            material_indices.push_back(0);
-        }
-
-        IPLStaticMeshSettings static_mesh_settings{};
-        static_mesh_settings.numVertices = verts.size();
-        static_mesh_settings.numTriangles = triangles.size();
-        static_mesh_settings.numMaterials = 1;
-        static_mesh_settings.vertices = verts.ptrw();
-        static_mesh_settings.triangles =  triangles.ptrw();
-        static_mesh_settings.materialIndices = material_indices.ptrw();
-        static_mesh_settings.materials = &default_replace_me;
+        if (surface_data.size() != Mesh::ARRAY_MAX) {
+            continue;
+        }
         IPLStaticMesh static_mesh = nullptr;
-        IPLerror errorCode = iplStaticMeshCreate(global_state->scene, &static_mesh_settings, &static_mesh);
-        if (errorCode) {
-            printf("Err code for iplStaticMeshCreate: %d\n", errorCode);
-            return (int)errorCode;
+        int error_code = create_surface_static_mesh_steamaudio(global_state, scene, surface_data[Mesh::ARRAY_VERTEX], surface_data[Mesh::ARRAY_INDEX], xform, &static_mesh);
+        if (error_code) {
+            return error_code;
+        }
+        if (static_mesh == nullptr) {
+            continue;
         }
 
-        static_meshes.push_back(iplStaticMeshRetain(static_mesh));
+        static_meshes.push_back(static_mesh);
     }
     return 0;
-    
 }
 
+int SteamAudioGeometry::create_geometry(const Ref<Mesh> mesh, Transform3D mesh_global_transform) {
+    return create_mesh_static_meshes_steamaudio(*global_state, global_state->scene, mesh, mesh_global_transform, static_meshes);
+}
+
+int SteamAudioGeometry::create_geometry_async(const Ref<Mesh> mesh, Transform3D mesh_global_transform) {
+    ERR_FAIL_COND_V(mesh.is_null(), -1);
+    //Snapshot the surface arrays here, the worker never touches the Mesh resource
+    GeometryJobSteamAudio * job = memnew(GeometryJobSteamAudio);
+    job->owner_id = get_instance_id();
+    job->xform = mesh_global_transform;
+    int n_surfaces = mesh->get_surface_count();
+    for (int sidx = 0; sidx < n_surfaces; sidx++) {
+        if (mesh->surface_get_primitive_type(sidx) != Mesh::PRIMITIVE_TRIANGLES) {
+            continue;
+        }
+        Array surface_data = mesh->surface_get_arrays(sidx);
+        if (surface_data.size() != Mesh::ARRAY_MAX) {
+            continue;
+        }
+        job->surface_verts.push_back(surface_data[Mesh::ARRAY_VERTEX]);
+        job->surface_indices.push_back(surface_data[Mesh::ARRAY_INDEX]);
+    }
+    pending_jobs++;
+    SteamAudioServer::get_singleton()->queue_geometry_job(job);
+    return 0;
+}
+
+//Static meshes enter and leave the global scene through these two so it can be captured.
+//Both are idempotent, async meshes are already in the scene when register_geometry() adds them again
+void add_scene_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, IPLStaticMesh static_mesh) {
+    if (global_state.scene_static_meshes.has(static_mesh)) {
+        return;
+    }
+    iplStaticMeshAdd(static_mesh, global_state.scene);
+    global_state.scene_static_meshes.push_back(static_mesh);
+}
+
+void remove_scene_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, IPLStaticMesh static_mesh) {
+    if (!global_state.scene_static_meshes.has(static_mesh)) {
+        return;
+    }
+    iplStaticMeshRemove(static_mesh, global_state.scene);
+    global_state.scene_static_meshes.erase(static_mesh);
+}
+
+bool SteamAudioGeometry::is_geometry_pending() const {
+    return pending_jobs > 0;
+}
+
+//Called by the server from tick() at its commit point
+void SteamAudioGeometry::commit_geometry_job(GeometryJobSteamAudio * job) {
+    pending_jobs--;
+    if (job->error_code) {
+        return;
+    }
+    for (int midx = 0; midx < job->static_meshes.size(); midx++) {
+        static_meshes.push_back(job->static_meshes[midx]);
+        add_scene_static_mesh_steamaudio(*global_state, job->static_meshes[midx]);
+    }
+    job->static_meshes.clear();
+}
+
+//Meshes still in the scene are taken out first, deregister_geometry() was never required before this
 int SteamAudioGeometry::destroy_geometry() {
     for (int midx = 0; midx < static_meshes.size(); midx++) {
         IPLStaticMesh mesh_ptr = static_meshes.get(midx);
+        remove_scene_static_mesh_steamaudio(*global_state, mesh_ptr);
         iplStaticMeshRelease(&mesh_ptr);
     }
     static_meshes.clear();
@@ -106,24 +650,28 @@ int SteamAudioGeometry::destroy_geometry() {
 
 int SteamAudioGeometry::register_geometry() {
     for (int midx = 0; midx < static_meshes.size(); midx++) {
-        iplStaticMeshAdd(static_meshes.get(midx), global_state->scene);
+        add_scene_static_mesh_steamaudio(*global_state, static_meshes.get(midx));
     }
     return 0;
 }
 
 int SteamAudioGeometry::deregister_geometry() {
     for (int midx = 0; midx < static_meshes.size(); midx++) {
-        iplStaticMeshRemove(static_meshes.get(midx), global_state->scene);
+        remove_scene_static_mesh_steamaudio(*global_state, static_meshes.get(midx));
     }
     return 0;
 }
 
 void SteamAudioGeometry::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("create_geometry", "mesh", "mesh_global_transform"), &SteamAudioGeometry::create_geometry);
+	ClassDB::bind_method(D_METHOD("create_geometry_async", "mesh", "mesh_global_transform"), &SteamAudioGeometry::create_geometry_async);
+	ClassDB::bind_method(D_METHOD("is_geometry_pending"), &SteamAudioGeometry::is_geometry_pending);
 	ClassDB::bind_method(D_METHOD("destroy_geometry"), &SteamAudioGeometry::destroy_geometry);
 
 	ClassDB::bind_method(D_METHOD("register_geometry"), &SteamAudioGeometry::register_geometry);
 	ClassDB::bind_method(D_METHOD("deregister_geometry"), &SteamAudioGeometry::deregister_geometry);
 
+	ADD_SIGNAL(MethodInfo("geometry_ready"));
+	ADD_SIGNAL(MethodInfo("geometry_failed", PropertyInfo(Variant::INT, "error_code")));
 }
 
@@ -28,6 +28,28 @@ SOFTWARE.
 #include "scene/3d/node_3d.h"
 #include "steamaudio_server.h"
 #include "scene/3d/mesh_instance_3d.h"
+
+struct MeshDataSteamAudio {
+    Vector<IPLVector3> verts;
+    Vector<IPLTriangle> triangles;
+    Vector<IPLint32> material_indices;
+};
+
+void transform_vertices_steamaudio(const Vector3 * verts_in, IPLVector3 * verts_out, int n_verts, const Transform3D& xform);
+int append_surface_steamaudio(const PackedVector3Array& verts_gd, const PackedInt32Array& indices_gd, const Transform3D& xform, MeshDataSteamAudio& mesh_data);
+int append_surface_steamaudio(const Array& surface_data, const Transform3D& xform, MeshDataSteamAudio& mesh_data);
+int simplify_mesh_data_steamaudio(MeshDataSteamAudio& mesh_data, float tolerance, float min_feature_size);
+int create_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, IPLScene scene, MeshDataSteamAudio& mesh_data, IPLStaticMesh * static_mesh);
+String mesh_cache_key_steamaudio(const GlobalStateSteamAudio& global_state, const PackedVector3Array& verts_gd, const PackedInt32Array& indices_gd, const Transform3D& xform, const IPLMaterial& material);
+int load_cached_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, IPLScene scene, const String& key, IPLStaticMesh * static_mesh);
+int save_cached_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, const String& key, IPLStaticMesh static_mesh, uint32_t n_tris_in, uint32_t n_tris_out);
+int trim_mesh_cache_steamaudio(const GlobalStateSteamAudio& global_state);
+int create_surface_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, IPLScene scene, const PackedVector3Array& verts_gd, const PackedInt32Array& indices_gd, const Transform3D& xform, IPLStaticMesh * static_mesh);
+int create_mesh_static_meshes_steamaudio(GlobalStateSteamAudio& global_state, IPLScene scene, const Ref<Mesh>& mesh, const Transform3D& xform, Vector<IPLStaticMesh>& static_meshes);
+int build_geometry_job_steamaudio(GlobalStateSteamAudio& global_state, GeometryJobSteamAudio * job);
+void add_scene_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, IPLStaticMesh static_mesh);
+void remove_scene_static_mesh_steamaudio(GlobalStateSteamAudio& global_state, IPLStaticMesh static_mesh);
+
 class SteamAudioGeometry : public Node3D {
     GDCLASS(SteamAudioGeometry, Node3D);
 public:
@@ -36,11 +58,15 @@ public:
     int register_geometry();
     int deregister_geometry();
     int create_geometry(const Ref<Mesh> mesh, Transform3D mesh_global_transform);
+    int create_geometry_async(const Ref<Mesh> mesh, Transform3D mesh_global_transform);
+    bool is_geometry_pending() const;
+    void commit_geometry_job(GeometryJobSteamAudio * job);
     int destroy_geometry();
     static void _bind_methods();
 private:
     GlobalStateSteamAudio * global_state = nullptr;
     Vector<IPLStaticMesh> static_meshes;
+    int pending_jobs = 0;
 };
 
 
@@ -0,0 +1,138 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_instanced_geometry.h"
+#include "steamaudio_memory.h"
+
+SteamAudioInstancedGeometry::SteamAudioInstancedGeometry() {
+    global_state = SteamAudioServer::get_singleton()->clone_global_state();
+}
+
+SteamAudioInstancedGeometry::~SteamAudioInstancedGeometry() {
+    destroy_instance();
+}
+
+void SteamAudioInstancedGeometry::create_instance() {
+    if (mesh.is_null() || instanced_mesh != nullptr) {
+        return;
+    }
+    IPLScene sub_scene = SteamAudioServer::get_singleton()->acquire_sub_scene(mesh);
+    if (sub_scene == nullptr) {
+        return;
+    }
+
+    instanced_transform = get_global_transform();
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SCENE_STEAMAUDIO);
+    IPLInstancedMeshSettings instanced_mesh_settings{};
+    instanced_mesh_settings.subScene = sub_scene;
+    instanced_mesh_settings.transform = GDTransformtoIPLMatrix4x4(instanced_transform);
+    IPLerror error_code = iplInstancedMeshCreate(global_state->scene, &instanced_mesh_settings, &instanced_mesh);
+    if (error_code) {
+        printf("Err code for iplInstancedMeshCreate: %d\n", error_code);
+        instanced_mesh = nullptr;
+        SteamAudioServer::get_singleton()->release_sub_scene(mesh);
+        return;
+    }
+    instanced_mesh_source = mesh;
+    iplInstancedMeshAdd(instanced_mesh, global_state->scene);
+    if (dynamic) {
+        SteamAudioServer::get_singleton()->add_dynamic_instance(this);
+    }
+}
+
+void SteamAudioInstancedGeometry::destroy_instance() {
+    if (instanced_mesh == nullptr) {
+        return;
+    }
+    SteamAudioServer::get_singleton()->remove_dynamic_instance(this);
+    iplInstancedMeshRemove(instanced_mesh, global_state->scene);
+    iplInstancedMeshRelease(&instanced_mesh);
+    instanced_mesh = nullptr;
+    SteamAudioServer::get_singleton()->release_sub_scene(instanced_mesh_source);
+    instanced_mesh_source.unref();
+}
+
+//Called by the server from tick() before the scene is committed
+void SteamAudioInstancedGeometry::update_instance_transform() {
+    if (instanced_mesh == nullptr) {
+        return;
+    }
+    Transform3D current_transform = get_global_transform();
+    if (current_transform == instanced_transform) {
+        return;
+    }
+    instanced_transform = current_transform;
+    iplInstancedMeshUpdateTransform(instanced_mesh, global_state->scene, GDTransformtoIPLMatrix4x4(instanced_transform));
+}
+
+void SteamAudioInstancedGeometry::set_mesh(const Ref<Mesh>& p_mesh) {
+    mesh = p_mesh;
+    if (is_inside_tree()) {
+        destroy_instance();
+        create_instance();
+    }
+}
+
+Ref<Mesh> SteamAudioInstancedGeometry::get_mesh() const {
+    return mesh;
+}
+
+void SteamAudioInstancedGeometry::set_dynamic(bool p_dynamic) {
+    dynamic = p_dynamic;
+    if (instanced_mesh == nullptr) {
+        return;
+    }
+    if (dynamic) {
+        SteamAudioServer::get_singleton()->add_dynamic_instance(this);
+    } else {
+        SteamAudioServer::get_singleton()->remove_dynamic_instance(this);
+    }
+}
+
+bool SteamAudioInstancedGeometry::is_dynamic() const {
+    return dynamic;
+}
+
+void SteamAudioInstancedGeometry::_notification(int p_what) {
+    switch (p_what) {
+        case NOTIFICATION_ENTER_TREE: {
+            create_instance();
+        } break;
+
+        case NOTIFICATION_EXIT_TREE: {
+            destroy_instance();
+        } break;
+    }
+}
+
+void SteamAudioInstancedGeometry::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_mesh", "mesh"), &SteamAudioInstancedGeometry::set_mesh);
+	ClassDB::bind_method(D_METHOD("get_mesh"), &SteamAudioInstancedGeometry::get_mesh);
+	ClassDB::bind_method(D_METHOD("set_dynamic", "dynamic"), &SteamAudioInstancedGeometry::set_dynamic);
+	ClassDB::bind_method(D_METHOD("is_dynamic"), &SteamAudioInstancedGeometry::is_dynamic);
+	ClassDB::bind_method(D_METHOD("update_instance_transform"), &SteamAudioInstancedGeometry::update_instance_transform);
+
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "mesh", PROPERTY_HINT_RESOURCE_TYPE, "Mesh"), "set_mesh", "get_mesh");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "dynamic"), "set_dynamic", "is_dynamic");
+}
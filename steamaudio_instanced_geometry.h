@@ -0,0 +1,57 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_INSTANCED_GEOMETRY_H
+#define STEAMAUDIO_INSTANCED_GEOMETRY_H
+
+#include "scene/3d/node_3d.h"
+#include "scene/resources/mesh.h"
+#include "steamaudio_server.h"
+
+class SteamAudioInstancedGeometry : public Node3D {
+    GDCLASS(SteamAudioInstancedGeometry, Node3D);
+public:
+    SteamAudioInstancedGeometry();
+    ~SteamAudioInstancedGeometry();
+    void set_mesh(const Ref<Mesh>& p_mesh);
+    Ref<Mesh> get_mesh() const;
+    void set_dynamic(bool p_dynamic);
+    bool is_dynamic() const;
+    void update_instance_transform();
+protected:
+    void _notification(int p_what);
+    static void _bind_methods();
+private:
+    GlobalStateSteamAudio * global_state = nullptr;
+    Ref<Mesh> mesh;
+    Ref<Mesh> instanced_mesh_source;
+    bool dynamic = false;
+    IPLInstancedMesh instanced_mesh = nullptr;
+    Transform3D instanced_transform;
+    void create_instance();
+    void destroy_instance();
+};
+
+
+#endif // STEAMAUDIO_INSTANCED_GEOMETRY_H
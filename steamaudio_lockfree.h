@@ -0,0 +1,226 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_LOCKFREE_H
+#define STEAMAUDIO_LOCKFREE_H
+
+#include "core/math/basis.h"
+#include "core/math/quaternion.h"
+#include "core/typedefs.h"
+#include <phonon.h>
+#include <atomic>
+#include <chrono>
+#include <string.h>
+
+//Monotonic time base for pose stamps, stats and traces, like OS::get_ticks_usec() but usable without an OS singleton
+inline uint64_t ticks_usec_steamaudio() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct PoseSampleSteamAudio {
+    uint64_t time_usec = 0;
+    IPLCoordinateSpace3 pose{};
+};
+
+//Single-producer ring of timestamped poses. Each slot is guarded by its own
+//sequence counter, so readers on any thread never block, they retry if the
+//producer lapped them mid-copy
+template <int SIZE>
+class PoseRingBufferSteamAudio {
+    struct Slot {
+        std::atomic<uint32_t> seq = 0;
+        PoseSampleSteamAudio sample;
+    };
+    Slot slots[SIZE];
+    std::atomic<uint64_t> write_count = 0;
+
+    bool read_slot(uint64_t index, PoseSampleSteamAudio& sample_out) const {
+        const Slot& slot = slots[index % SIZE];
+        uint32_t seq_before = slot.seq.load(std::memory_order_acquire);
+        if (seq_before & 1) {
+            return false;
+        }
+        memcpy((void *)&sample_out, (const void *)&slot.sample, sizeof(PoseSampleSteamAudio));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.seq.load(std::memory_order_relaxed) == seq_before;
+    }
+
+public:
+    void push(uint64_t time_usec, const IPLCoordinateSpace3& pose) {
+        uint64_t index = write_count.load(std::memory_order_relaxed);
+        Slot& slot = slots[index % SIZE];
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.sample.time_usec = time_usec;
+        slot.sample.pose = pose;
+        slot.seq.store(seq + 2, std::memory_order_release);
+        write_count.store(index + 1, std::memory_order_release);
+    }
+
+    //Newest sample and the one before it, false until two consistent samples exist
+    bool read_latest(PoseSampleSteamAudio& newest, PoseSampleSteamAudio& previous) const {
+        for (int attempt = 0; attempt < 4; attempt++) {
+            uint64_t count = write_count.load(std::memory_order_acquire);
+            if (count < 2) {
+                return false;
+            }
+            if (read_slot(count - 1, newest) && read_slot(count - 2, previous)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear() {
+        write_count.store(0, std::memory_order_release);
+    }
+};
+
+//Single-producer single-consumer triple buffer. The producer fills write_slot()
+//and publishes it, the consumer acquires the newest published slot. Neither
+//side waits on the other and the slot being read is never written
+template <typename T>
+class TripleBufferSteamAudio {
+    static const uint32_t FRESH_BIT = 4;
+    static const uint32_t INDEX_MASK = 3;
+    struct Slot {
+        T value{};
+        uint64_t generation = 0;
+        uint64_t time_usec = 0;
+    };
+    Slot slots[3];
+    std::atomic<uint32_t> middle_idx = 2;
+    uint32_t write_idx = 0;
+    uint32_t read_idx = 1;
+    uint64_t write_generation = 0;
+    bool read_valid = false;
+    std::atomic<uint64_t> dropped = 0;
+    std::atomic<uint64_t> stale = 0;
+
+public:
+    //Producer side
+    T& write_slot() {
+        return slots[write_idx].value;
+    }
+
+    void publish(uint64_t time_usec) {
+        slots[write_idx].generation = ++write_generation;
+        slots[write_idx].time_usec = time_usec;
+        uint32_t prev_middle = middle_idx.exchange(write_idx | FRESH_BIT, std::memory_order_acq_rel);
+        if (prev_middle & FRESH_BIT) {
+            //The consumer never saw the result we just replaced
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        write_idx = prev_middle & INDEX_MASK;
+    }
+
+    //Consumer side, returns false if nothing has ever been published
+    bool acquire() {
+        if (middle_idx.load(std::memory_order_relaxed) & FRESH_BIT) {
+            uint32_t prev_middle = middle_idx.exchange(read_idx, std::memory_order_acq_rel);
+            read_idx = prev_middle & INDEX_MASK;
+            read_valid = true;
+        } else if (read_valid) {
+            //Reusing the previous result
+            stale.fetch_add(1, std::memory_order_relaxed);
+        }
+        return read_valid;
+    }
+
+    bool has_value() const {
+        return read_valid;
+    }
+
+    const T& read() const {
+        return slots[read_idx].value;
+    }
+
+    uint64_t read_generation() const {
+        return slots[read_idx].generation;
+    }
+
+    uint64_t read_time_usec() const {
+        return slots[read_idx].time_usec;
+    }
+
+    //Forgets every published value, only while neither side is running
+    void reset() {
+        middle_idx.store(2, std::memory_order_relaxed);
+        write_idx = 0;
+        read_idx = 1;
+        read_valid = false;
+    }
+
+    uint64_t get_dropped_count() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_stale_count() const {
+        return stale.load(std::memory_order_relaxed);
+    }
+};
+
+inline Basis pose_basis_steamaudio(const IPLCoordinateSpace3& pose) {
+    Vector3 right(pose.right.x, pose.right.y, pose.right.z);
+    Vector3 up(pose.up.x, pose.up.y, pose.up.z);
+    Vector3 back(-pose.ahead.x, -pose.ahead.y, -pose.ahead.z);
+    return Basis(right, up, back);
+}
+
+//Constant linear and angular velocity from the last two samples, carried forward
+//to target_usec but never further than max_horizon_usec past the newest sample
+inline IPLCoordinateSpace3 extrapolate_pose_steamaudio(const PoseSampleSteamAudio& previous, const PoseSampleSteamAudio& newest, uint64_t target_usec, uint64_t max_horizon_usec) {
+    if (newest.time_usec <= previous.time_usec || target_usec <= newest.time_usec) {
+        return newest.pose;
+    }
+    uint64_t horizon_usec = MIN(target_usec - newest.time_usec, max_horizon_usec);
+    real_t factor = (real_t)horizon_usec / (real_t)(newest.time_usec - previous.time_usec);
+
+    IPLCoordinateSpace3 pose_out = newest.pose;
+    pose_out.origin.x += (newest.pose.origin.x - previous.pose.origin.x) * factor;
+    pose_out.origin.y += (newest.pose.origin.y - previous.pose.origin.y) * factor;
+    pose_out.origin.z += (newest.pose.origin.z - previous.pose.origin.z) * factor;
+
+    Quaternion rot_prev = pose_basis_steamaudio(previous.pose).get_rotation_quaternion();
+    Quaternion rot_new = pose_basis_steamaudio(newest.pose).get_rotation_quaternion();
+    Quaternion rot_delta = (rot_new * rot_prev.inverse()).normalized();
+    if (rot_delta.w < 0.0f) {
+        rot_delta = -rot_delta;
+    }
+    real_t angle = rot_delta.get_angle();
+    if (angle < 1e-5f) {
+        return pose_out;
+    }
+    Basis basis_out = Basis(Quaternion(rot_delta.get_axis(), angle * factor) * rot_new);
+    Vector3 right = basis_out.get_column(0);
+    Vector3 up = basis_out.get_column(1);
+    Vector3 ahead = -basis_out.get_column(2);
+    pose_out.right = IPLVector3{(float)right.x, (float)right.y, (float)right.z};
+    pose_out.up = IPLVector3{(float)up.x, (float)up.y, (float)up.z};
+    pose_out.ahead = IPLVector3{(float)ahead.x, (float)ahead.y, (float)ahead.z};
+    return pose_out;
+}
+
+#endif // STEAMAUDIO_LOCKFREE_H
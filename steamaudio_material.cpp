@@ -0,0 +1,85 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_material.h"
+
+SteamAudioMaterial::SteamAudioMaterial() {
+    material = *get_default_ipl_material();
+}
+
+SteamAudioMaterial::~SteamAudioMaterial() {
+}
+
+void SteamAudioMaterial::set_absorption(const Vector3& p_absorption) {
+    for (int band = 0; band < 3; band++) {
+        material.absorption[band] = CLAMP(p_absorption[band], 0.0f, 1.0f);
+    }
+    emit_changed();
+}
+
+Vector3 SteamAudioMaterial::get_absorption() const {
+    return Vector3(material.absorption[0], material.absorption[1], material.absorption[2]);
+}
+
+void SteamAudioMaterial::set_scattering(float p_scattering) {
+    material.scattering = CLAMP(p_scattering, 0.0f, 1.0f);
+    emit_changed();
+}
+
+float SteamAudioMaterial::get_scattering() const {
+    return material.scattering;
+}
+
+void SteamAudioMaterial::set_transmission(const Vector3& p_transmission) {
+    for (int band = 0; band < 3; band++) {
+        material.transmission[band] = CLAMP(p_transmission[band], 0.0f, 1.0f);
+    }
+    emit_changed();
+}
+
+Vector3 SteamAudioMaterial::get_transmission() const {
+    return Vector3(material.transmission[0], material.transmission[1], material.transmission[2]);
+}
+
+IPLMaterial * SteamAudioMaterial::get_ipl_material() {
+    return &material;
+}
+
+//Same values the static mesh path uses for untagged geometry
+IPLMaterial * SteamAudioMaterial::get_default_ipl_material() {
+    return default_ipl_material_steamaudio();
+}
+
+void SteamAudioMaterial::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_absorption", "absorption"), &SteamAudioMaterial::set_absorption);
+	ClassDB::bind_method(D_METHOD("get_absorption"), &SteamAudioMaterial::get_absorption);
+	ClassDB::bind_method(D_METHOD("set_scattering", "scattering"), &SteamAudioMaterial::set_scattering);
+	ClassDB::bind_method(D_METHOD("get_scattering"), &SteamAudioMaterial::get_scattering);
+	ClassDB::bind_method(D_METHOD("set_transmission", "transmission"), &SteamAudioMaterial::set_transmission);
+	ClassDB::bind_method(D_METHOD("get_transmission"), &SteamAudioMaterial::get_transmission);
+
+	ADD_PROPERTY(PropertyInfo(Variant::VECTOR3, "absorption"), "set_absorption", "get_absorption");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "scattering", PROPERTY_HINT_RANGE, "0,1,0.01"), "set_scattering", "get_scattering");
+	ADD_PROPERTY(PropertyInfo(Variant::VECTOR3, "transmission"), "set_transmission", "get_transmission");
+}
@@ -0,0 +1,50 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_MATERIAL_H
+#define STEAMAUDIO_MATERIAL_H
+
+#include "core/io/resource.h"
+#include "godot_steamaudio.h"
+
+class SteamAudioMaterial : public Resource {
+    GDCLASS(SteamAudioMaterial, Resource);
+public:
+    SteamAudioMaterial();
+    ~SteamAudioMaterial();
+    void set_absorption(const Vector3& p_absorption);
+    Vector3 get_absorption() const;
+    void set_scattering(float p_scattering);
+    float get_scattering() const;
+    void set_transmission(const Vector3& p_transmission);
+    Vector3 get_transmission() const;
+    IPLMaterial * get_ipl_material();
+    static IPLMaterial * get_default_ipl_material();
+protected:
+    static void _bind_methods();
+private:
+    IPLMaterial material{};
+};
+
+#endif // STEAMAUDIO_MATERIAL_H
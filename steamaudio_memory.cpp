@@ -0,0 +1,161 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_memory.h"
+#include "steamaudio_realtime.h"
+#include "core/os/memory.h"
+#include "core/templates/local_vector.h"
+#include <mutex>
+
+//Stored just below each aligned block
+struct MemoryHeaderSteamAudio {
+    void * raw;
+    uint64_t size;
+    MemoryLedgerSteamAudio * ledger;
+    MemoryCategorySteamAudio category;
+};
+
+static MemoryLedgerSteamAudio memory_live_ledger_steamaudio;
+static MemoryLedgerSteamAudio memory_private_ledger_steamaudio;
+static std::mutex memory_merged_ledgers_mtx_steamaudio;
+static LocalVector<MemoryLedgerSteamAudio *> memory_merged_ledgers_steamaudio;
+static thread_local MemoryLedgerSteamAudio * memory_ledger_tls_steamaudio = nullptr;
+static thread_local MemoryCategorySteamAudio memory_category_tls_steamaudio = MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO;
+
+static const char * memory_category_names_steamaudio[MEMORY_CATEGORY_MAX_STEAMAUDIO] = {
+    "other",
+    "hrtf",
+    "scene",
+    "simulator",
+    "source_buffers",
+    "effects",
+};
+
+MemoryCategoryScopeSteamAudio::MemoryCategoryScopeSteamAudio(MemoryCategorySteamAudio category) {
+    previous = memory_category_tls_steamaudio;
+    memory_category_tls_steamaudio = category;
+}
+
+MemoryCategoryScopeSteamAudio::~MemoryCategoryScopeSteamAudio() {
+    memory_category_tls_steamaudio = previous;
+}
+
+MemoryLedgerScopeSteamAudio::MemoryLedgerScopeSteamAudio(MemoryLedgerSteamAudio& ledger) {
+    previous = memory_ledger_tls_steamaudio;
+    memory_ledger_tls_steamaudio = &ledger;
+}
+
+MemoryLedgerScopeSteamAudio::~MemoryLedgerScopeSteamAudio() {
+    memory_ledger_tls_steamaudio = previous;
+}
+
+MemoryLedgerSteamAudio& get_live_memory_ledger_steamaudio() {
+    return memory_live_ledger_steamaudio;
+}
+
+MemoryLedgerSteamAudio& get_private_memory_ledger_steamaudio() {
+    return memory_private_ledger_steamaudio;
+}
+
+static MemoryLedgerSteamAudio * current_ledger_steamaudio() {
+    return memory_ledger_tls_steamaudio ? memory_ledger_tls_steamaudio : &memory_live_ledger_steamaudio;
+}
+
+static MemoryLedgerSteamAudio * resolve_ledger_steamaudio(MemoryLedgerSteamAudio * ledger) {
+    MemoryLedgerSteamAudio * merged = ledger->merged_into.load(std::memory_order_acquire);
+    while (merged != nullptr) {
+        ledger = merged;
+        merged = ledger->merged_into.load(std::memory_order_acquire);
+    }
+    return ledger;
+}
+
+static void charge_ledger_steamaudio(MemoryLedgerSteamAudio * ledger, MemoryCategorySteamAudio category, int64_t bytes) {
+    ledger->bytes[category].fetch_add(bytes, std::memory_order_relaxed);
+    int64_t total = ledger->total.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = ledger->peak.load(std::memory_order_relaxed);
+    while (total > peak && !ledger->peak.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {
+    }
+}
+
+void track_memory_steamaudio(MemoryCategorySteamAudio category, int64_t bytes) {
+    charge_ledger_steamaudio(resolve_ledger_steamaudio(current_ledger_steamaudio()), category, bytes);
+}
+
+//Main thread only, after the thread that built the staged objects has finished
+void merge_memory_ledger_steamaudio(MemoryLedgerSteamAudio * staged, MemoryLedgerSteamAudio& ledger) {
+    staged->merged_into.store(&ledger, std::memory_order_release);
+    for (int category = 0; category < MEMORY_CATEGORY_MAX_STEAMAUDIO; category++) {
+        int64_t bytes = staged->bytes[category].exchange(0, std::memory_order_relaxed);
+        if (bytes != 0) {
+            charge_ledger_steamaudio(&ledger, (MemoryCategorySteamAudio)category, bytes);
+        }
+    }
+    staged->total.store(0, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(memory_merged_ledgers_mtx_steamaudio);
+    memory_merged_ledgers_steamaudio.push_back(staged);
+}
+
+void * IPLCALL allocate_steamaudio(IPLsize size, IPLsize alignment) {
+    REALTIME_UNSAFE_STEAMAUDIO("alloc: Steam Audio");
+    alignment = MAX(alignment, alignof(MemoryHeaderSteamAudio));
+    uint8_t * raw = (uint8_t *)memalloc(size + alignment + sizeof(MemoryHeaderSteamAudio));
+    if (raw == nullptr) {
+        return nullptr;
+    }
+    uintptr_t block = ((uintptr_t)(raw + sizeof(MemoryHeaderSteamAudio)) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    MemoryHeaderSteamAudio * header = (MemoryHeaderSteamAudio *)block - 1;
+    header->raw = raw;
+    header->size = size;
+    header->ledger = resolve_ledger_steamaudio(current_ledger_steamaudio());
+    header->category = memory_category_tls_steamaudio;
+    charge_ledger_steamaudio(header->ledger, header->category, size);
+    return (void *)block;
+}
+
+void IPLCALL free_steamaudio(void * block) {
+    if (block == nullptr) {
+        return;
+    }
+    REALTIME_UNSAFE_STEAMAUDIO("free: Steam Audio");
+    MemoryHeaderSteamAudio * header = (MemoryHeaderSteamAudio *)block - 1;
+    charge_ledger_steamaudio(resolve_ledger_steamaudio(header->ledger), header->category, -(int64_t)header->size);
+    memfree(header->raw);
+}
+
+int64_t get_memory_bytes_steamaudio(const MemoryLedgerSteamAudio& ledger, MemoryCategorySteamAudio category) {
+    return ledger.bytes[category].load(std::memory_order_relaxed);
+}
+
+int64_t get_total_memory_bytes_steamaudio(const MemoryLedgerSteamAudio& ledger) {
+    return ledger.total.load(std::memory_order_relaxed);
+}
+
+int64_t get_peak_memory_bytes_steamaudio(const MemoryLedgerSteamAudio& ledger) {
+    return ledger.peak.load(std::memory_order_relaxed);
+}
+
+const char * get_memory_category_name_steamaudio(MemoryCategorySteamAudio category) {
+    return memory_category_names_steamaudio[category];
+}
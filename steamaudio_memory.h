@@ -0,0 +1,90 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_MEMORY_H
+#define STEAMAUDIO_MEMORY_H
+
+#include "core/typedefs.h"
+#include <phonon.h>
+#include <atomic>
+
+//Steam Audio allocates through allocate_steamaudio(), which charges each block to the calling thread's
+//current ledger and category. Threads without a category scope are Steam Audio's own workers, which only
+//run simulation jobs, so that is what they are charged to
+enum MemoryCategorySteamAudio {
+    MEMORY_CATEGORY_OTHER_STEAMAUDIO,
+    MEMORY_CATEGORY_HRTF_STEAMAUDIO,
+    MEMORY_CATEGORY_SCENE_STEAMAUDIO,
+    MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO,
+    MEMORY_CATEGORY_SOURCE_BUFFERS_STEAMAUDIO,
+    MEMORY_CATEGORY_EFFECTS_STEAMAUDIO,
+    MEMORY_CATEGORY_MAX_STEAMAUDIO
+};
+
+//Byte counts for one set of Steam Audio objects. The live server uses the live ledger, private states
+//(raytracer benchmarks, capture replays) and staged quality changes charge their own so they don't show up
+//in the server's numbers until they become part of it
+struct MemoryLedgerSteamAudio {
+    std::atomic<int64_t> bytes[MEMORY_CATEGORY_MAX_STEAMAUDIO] = {};
+    std::atomic<int64_t> total = 0;
+    std::atomic<int64_t> peak = 0;
+    //Set once a staged ledger has been merged, frees of its blocks are charged there from then on
+    std::atomic<MemoryLedgerSteamAudio *> merged_into = nullptr;
+};
+
+void * IPLCALL allocate_steamaudio(IPLsize size, IPLsize alignment);
+void IPLCALL free_steamaudio(void * block);
+
+MemoryLedgerSteamAudio& get_live_memory_ledger_steamaudio();
+//Shared by the private states. Steam Audio may free a block long after the call that allocated it,
+//so ledgers that blocks point at are never destroyed while the process runs
+MemoryLedgerSteamAudio& get_private_memory_ledger_steamaudio();
+//Moves a heap-allocated staged ledger's bytes into another one, once whatever was staged has become part
+//of it or been released. Blocks still point at the staged ledger, so the memory module keeps it from here on
+void merge_memory_ledger_steamaudio(MemoryLedgerSteamAudio * staged, MemoryLedgerSteamAudio& ledger);
+
+//For module allocations that don't go through Steam Audio, charged to the calling thread's ledger
+void track_memory_steamaudio(MemoryCategorySteamAudio category, int64_t bytes);
+int64_t get_memory_bytes_steamaudio(const MemoryLedgerSteamAudio& ledger, MemoryCategorySteamAudio category);
+int64_t get_total_memory_bytes_steamaudio(const MemoryLedgerSteamAudio& ledger);
+int64_t get_peak_memory_bytes_steamaudio(const MemoryLedgerSteamAudio& ledger);
+const char * get_memory_category_name_steamaudio(MemoryCategorySteamAudio category);
+
+struct MemoryCategoryScopeSteamAudio {
+    MemoryCategorySteamAudio previous;
+    explicit MemoryCategoryScopeSteamAudio(MemoryCategorySteamAudio category);
+    ~MemoryCategoryScopeSteamAudio();
+};
+
+struct MemoryLedgerScopeSteamAudio {
+    MemoryLedgerSteamAudio * previous;
+    explicit MemoryLedgerScopeSteamAudio(MemoryLedgerSteamAudio& ledger);
+    ~MemoryLedgerScopeSteamAudio();
+};
+
+//Blocks remember their ledger and category, so frees need no scope
+#define MEMORY_CATEGORY_STEAMAUDIO(category) MemoryCategoryScopeSteamAudio memory_category_scope_steamaudio(category)
+#define MEMORY_LEDGER_STEAMAUDIO(ledger) MemoryLedgerScopeSteamAudio memory_ledger_scope_steamaudio(ledger)
+
+#endif // STEAMAUDIO_MEMORY_H
@@ -0,0 +1,396 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_physics_raytracer.h"
+#include "core/math/convex_hull.h"
+#include "core/math/geometry_3d.h"
+#include "scene/3d/physics_body_3d.h"
+#include "scene/resources/box_shape_3d.h"
+#include "scene/resources/capsule_shape_3d.h"
+#include "scene/resources/concave_polygon_shape_3d.h"
+#include "scene/resources/convex_polygon_shape_3d.h"
+#include "scene/resources/cylinder_shape_3d.h"
+#include "scene/resources/sphere_shape_3d.h"
+#include "steamaudio_material.h"
+
+static void append_mesh_data_faces_steamaudio(const Geometry3D::MeshData& mesh_data, Vector<Vector3>& faces) {
+    for (const Geometry3D::MeshData::Face& face : mesh_data.faces) {
+        for (uint32_t vidx = 2; vidx < face.indices.size(); vidx++) {
+            faces.push_back(mesh_data.vertices[face.indices[0]]);
+            faces.push_back(mesh_data.vertices[face.indices[vidx-1]]);
+            faces.push_back(mesh_data.vertices[face.indices[vidx]]);
+        }
+    }
+}
+
+//Cheap to read every snapshot, a changed signature means the shape was edited and needs new faces.
+//Shapes the physics raytracer can't see (height maps, world boundaries) return false
+static bool get_shape_signature_steamaudio(Shape3D * shape, PhysicsShapeCacheEntrySteamAudio& entry) {
+    if (BoxShape3D * box = Object::cast_to<BoxShape3D>(shape)) {
+        entry.params = box->get_size();
+    } else if (SphereShape3D * sphere = Object::cast_to<SphereShape3D>(shape)) {
+        entry.params = Vector3(sphere->get_radius(), 0.0f, 0.0f);
+    } else if (CapsuleShape3D * capsule = Object::cast_to<CapsuleShape3D>(shape)) {
+        entry.params = Vector3(capsule->get_radius(), capsule->get_height(), 0.0f);
+    } else if (CylinderShape3D * cylinder = Object::cast_to<CylinderShape3D>(shape)) {
+        entry.params = Vector3(cylinder->get_radius(), cylinder->get_height(), 0.0f);
+    } else if (ConvexPolygonShape3D * convex = Object::cast_to<ConvexPolygonShape3D>(shape)) {
+        //Copy-on-write, the pointer only changes when new points are set
+        Vector<Vector3> points = convex->get_points();
+        entry.data = points.ptr();
+        entry.data_size = points.size();
+    } else if (ConcavePolygonShape3D * concave = Object::cast_to<ConcavePolygonShape3D>(shape)) {
+        Vector<Vector3> faces = concave->get_faces();
+        entry.data = faces.ptr();
+        entry.data_size = faces.size();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void get_shape_faces_steamaudio(Shape3D * shape, Vector<Vector3>& faces) {
+    Vector<Plane> planes;
+    if (BoxShape3D * box = Object::cast_to<BoxShape3D>(shape)) {
+        planes = Geometry3D::build_box_planes(box->get_size() * 0.5f);
+    } else if (SphereShape3D * sphere = Object::cast_to<SphereShape3D>(shape)) {
+        planes = Geometry3D::build_sphere_planes(sphere->get_radius(), 8, 12, Vector3::AXIS_Y);
+    } else if (CapsuleShape3D * capsule = Object::cast_to<CapsuleShape3D>(shape)) {
+        planes = Geometry3D::build_capsule_planes(capsule->get_radius(), MAX(capsule->get_height() * 0.5f - capsule->get_radius(), 0.0f), 12, 4, Vector3::AXIS_Y);
+    } else if (CylinderShape3D * cylinder = Object::cast_to<CylinderShape3D>(shape)) {
+        planes = Geometry3D::build_cylinder_planes(cylinder->get_radius(), cylinder->get_height() * 0.5f, 12, Vector3::AXIS_Y);
+    } else if (ConvexPolygonShape3D * convex = Object::cast_to<ConvexPolygonShape3D>(shape)) {
+        Geometry3D::MeshData mesh_data;
+        if (ConvexHullComputer::convex_hull(convex->get_points(), mesh_data) == OK) {
+            append_mesh_data_faces_steamaudio(mesh_data, faces);
+        }
+        return;
+    } else if (ConcavePolygonShape3D * concave = Object::cast_to<ConcavePolygonShape3D>(shape)) {
+        faces = concave->get_faces();
+        return;
+    }
+    append_mesh_data_faces_steamaudio(Geometry3D::build_convex_mesh(planes), faces);
+}
+
+//Shape resources are shared between bodies, faces are only rebuilt when the shape changes
+static Ref<TriangleMesh> get_shape_triangle_mesh_steamaudio(const Ref<Shape3D>& shape, PhysicsSnapshotCacheSteamAudio& cache, HashSet<ObjectID>& seen_shapes) {
+    ObjectID shape_id = shape->get_instance_id();
+    PhysicsShapeCacheEntrySteamAudio entry;
+    if (!get_shape_signature_steamaudio(shape.ptr(), entry)) {
+        return Ref<TriangleMesh>();
+    }
+    seen_shapes.insert(shape_id);
+    PhysicsShapeCacheEntrySteamAudio * cached = cache.shapes.getptr(shape_id);
+    if (cached && cached->params == entry.params && cached->data == entry.data && cached->data_size == entry.data_size) {
+        return cached->faces;
+    }
+    Vector<Vector3> faces;
+    get_shape_faces_steamaudio(shape.ptr(), faces);
+    if (faces.is_empty()) {
+        cache.shapes.erase(shape_id);
+        return Ref<TriangleMesh>();
+    }
+    entry.faces.instantiate();
+    entry.faces->create(faces);
+    cache.shapes[shape_id] = entry;
+    return entry.faces;
+}
+
+static IPLMaterial get_body_material_steamaudio(Object * body) {
+    Variant material_meta = body->get_meta(SNAME("steamaudio_material"), Variant());
+    SteamAudioMaterial * material = Object::cast_to<SteamAudioMaterial>(material_meta.get_validated_object());
+    if (material == nullptr) {
+        return *SteamAudioMaterial::get_default_ipl_material();
+    }
+    return *material->get_ipl_material();
+}
+
+static void snapshot_body_steamaudio(PhysicsBody3D * body, PhysicsSnapshotCacheSteamAudio& cache, LocalVector<PhysicsShapeSnapshotSteamAudio>& shapes, HashSet<ObjectID>& seen_shapes) {
+    ObjectID body_id = body->get_instance_id();
+    if (!cache.object_indices.has(body_id)) {
+        cache.object_indices[body_id] = cache.next_object_index++;
+    }
+    IPLMaterial material = get_body_material_steamaudio(body);
+    Transform3D body_xform = body->get_global_transform();
+    List<uint32_t> owners;
+    body->get_shape_owners(&owners);
+    for (const uint32_t owner : owners) {
+        if (body->is_shape_owner_disabled(owner)) {
+            continue;
+        }
+        Transform3D owner_xform = body_xform * body->shape_owner_get_transform(owner);
+        for (int sidx = 0; sidx < body->shape_owner_get_shape_count(owner); sidx++) {
+            Ref<Shape3D> shape = body->shape_owner_get_shape(owner, sidx);
+            if (shape.is_null()) {
+                continue;
+            }
+            Ref<TriangleMesh> faces = get_shape_triangle_mesh_steamaudio(shape, cache, seen_shapes);
+            if (faces.is_null()) {
+                continue;
+            }
+            PhysicsShapeSnapshotSteamAudio shape_snapshot;
+            shape_snapshot.faces = faces;
+            shape_snapshot.xform = owner_xform;
+            shape_snapshot.material = material;
+            shape_snapshot.object_index = cache.object_indices[body_id];
+            shapes.push_back(shape_snapshot);
+        }
+    }
+}
+
+void collect_physics_bodies_steamaudio(Node * root, PhysicsSnapshotCacheSteamAudio& cache) {
+    track_physics_node_steamaudio(root, true, cache);
+    for (int cidx = 0; cidx < root->get_child_count(); cidx++) {
+        collect_physics_bodies_steamaudio(root->get_child(cidx), cache);
+    }
+}
+
+//Areas don't block rays, same as the intersect_ray defaults this replaces
+void track_physics_node_steamaudio(Node * node, bool in_tree, PhysicsSnapshotCacheSteamAudio& cache) {
+    if (Object::cast_to<PhysicsBody3D>(node) == nullptr) {
+        return;
+    }
+    if (in_tree) {
+        cache.bodies.insert(node->get_instance_id());
+    } else {
+        cache.bodies.erase(node->get_instance_id());
+    }
+}
+
+static bool same_shapes_steamaudio(const LocalVector<PhysicsShapeSnapshotSteamAudio>& a, const LocalVector<PhysicsShapeSnapshotSteamAudio>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (uint32_t sidx = 0; sidx < a.size(); sidx++) {
+        if (a[sidx].faces != b[sidx].faces || a[sidx].xform != b[sidx].xform || a[sidx].object_index != b[sidx].object_index
+                || memcmp(&(a[sidx].material), &(b[sidx].material), sizeof(IPLMaterial)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//Fills node_index with shapes [first, first + count) and splits them at the middle of their centers' longest axis,
+//until leaves hold PHYSICS_BVH_LEAF_SIZE_STEAMAUDIO shapes or the depth limit is reached. Shapes are reordered in place
+//so every leaf is one range
+static void build_bvh_node_steamaudio(PhysicsSnapshotSteamAudio * snapshot, uint32_t node_index, uint32_t first, uint32_t count, int depth) {
+    AABB aabb = snapshot->shapes[first].aabb;
+    AABB centers(snapshot->shapes[first].aabb.get_center(), Vector3());
+    for (uint32_t sidx = first + 1; sidx < first + count; sidx++) {
+        aabb.merge_with(snapshot->shapes[sidx].aabb);
+        centers.expand_to(snapshot->shapes[sidx].aabb.get_center());
+    }
+    snapshot->nodes[node_index].aabb = aabb;
+    if (count <= PHYSICS_BVH_LEAF_SIZE_STEAMAUDIO || depth >= PHYSICS_BVH_MAX_DEPTH_STEAMAUDIO) {
+        snapshot->nodes[node_index].first = first;
+        snapshot->nodes[node_index].count = count;
+        return;
+    }
+
+    int axis = centers.get_longest_axis_index();
+    real_t split = centers.get_center()[axis];
+    uint32_t mid = first;
+    for (uint32_t sidx = first; sidx < first + count; sidx++) {
+        if (snapshot->shapes[sidx].aabb.get_center()[axis] < split) {
+            SWAP(snapshot->shapes[sidx], snapshot->shapes[mid]);
+            mid++;
+        }
+    }
+    //All centers on one side, halve the range instead
+    if (mid == first || mid == first + count) {
+        mid = first + count / 2;
+    }
+    //Children sit next to each other so the node only stores the first one
+    uint32_t child = snapshot->nodes.size();
+    snapshot->nodes.push_back(PhysicsBVHNodeSteamAudio());
+    snapshot->nodes.push_back(PhysicsBVHNodeSteamAudio());
+    snapshot->nodes[node_index].child = child;
+    build_bvh_node_steamaudio(snapshot, child, first, mid - first, depth + 1);
+    build_bvh_node_steamaudio(snapshot, child + 1, mid, first + count - mid, depth + 1);
+}
+
+PhysicsSnapshotSteamAudio * build_physics_snapshot_steamaudio(const Ref<World3D>& world, PhysicsSnapshotCacheSteamAudio& cache) {
+    LocalVector<PhysicsShapeSnapshotSteamAudio> shapes;
+    HashSet<ObjectID> seen_shapes;
+    HashSet<ObjectID> seen_bodies;
+    for (const ObjectID& body_id : cache.bodies) {
+        PhysicsBody3D * body = Object::cast_to<PhysicsBody3D>(ObjectDB::get_instance(body_id));
+        if (body == nullptr || body->get_world_3d() != world) {
+            continue;
+        }
+        seen_bodies.insert(body_id);
+        snapshot_body_steamaudio(body, cache, shapes, seen_shapes);
+    }
+
+    //Forget what left the world so the caches don't grow
+    LocalVector<ObjectID> stale;
+    for (const KeyValue<ObjectID, PhysicsShapeCacheEntrySteamAudio>& kv : cache.shapes) {
+        if (!seen_shapes.has(kv.key)) {
+            stale.push_back(kv.key);
+        }
+    }
+    for (const ObjectID& id : stale) {
+        cache.shapes.erase(id);
+    }
+    stale.clear();
+    for (const KeyValue<ObjectID, IPLint32>& kv : cache.object_indices) {
+        if (!seen_bodies.has(kv.key)) {
+            stale.push_back(kv.key);
+        }
+    }
+    for (const ObjectID& id : stale) {
+        cache.object_indices.erase(id);
+    }
+
+    //A static level keeps its snapshot and hierarchy, only moved, added or edited shapes cost a rebuild
+    if (same_shapes_steamaudio(shapes, cache.last_shapes)) {
+        return nullptr;
+    }
+    cache.last_shapes = shapes;
+
+    PhysicsSnapshotSteamAudio * snapshot = memnew(PhysicsSnapshotSteamAudio);
+    snapshot->shapes = shapes;
+    for (PhysicsShapeSnapshotSteamAudio& shape : snapshot->shapes) {
+        shape.inv_xform = shape.xform.affine_inverse();
+        shape.normal_basis = shape.xform.basis.inverse().transposed();
+        shape.aabb = shape.xform.xform(shape.faces->get_aabb());
+    }
+    if (!snapshot->shapes.is_empty()) {
+        snapshot->nodes.push_back(PhysicsBVHNodeSteamAudio());
+        build_bvh_node_steamaudio(snapshot, 0, 0, snapshot->shapes.size(), 0);
+    }
+    return snapshot;
+}
+
+static const PhysicsSnapshotSteamAudio * get_snapshot_steamaudio(void * user_data) {
+    GlobalStateSteamAudio * global_state = (GlobalStateSteamAudio *)user_data;
+    return global_state->physics_snapshot;
+}
+
+//Closest hit over every shape whose bounds the segment crosses, nullptr if nothing is hit.
+//Walks the hierarchy, the segment is cut back to each hit so farther nodes are skipped
+static const PhysicsShapeSnapshotSteamAudio * intersect_snapshot_steamaudio(const PhysicsSnapshotSteamAudio * snapshot, const Vector3& from, const Vector3& to, Vector3& r_point, Vector3& r_normal, bool any_hit) {
+    const PhysicsShapeSnapshotSteamAudio * closest = nullptr;
+    if (snapshot->nodes.is_empty()) {
+        return closest;
+    }
+    Vector3 segment_end = to;
+    //Each level pops one node and pushes two, so the stack never holds more than the depth limit plus one
+    uint32_t stack[PHYSICS_BVH_MAX_DEPTH_STEAMAUDIO + 1];
+    uint32_t stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const PhysicsBVHNodeSteamAudio& node = snapshot->nodes[stack[--stack_size]];
+        if (!node.aabb.intersects_segment(from, segment_end)) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[stack_size++] = node.child + 1;
+            stack[stack_size++] = node.child;
+            continue;
+        }
+        for (uint32_t sidx = node.first; sidx < node.first + node.count; sidx++) {
+            const PhysicsShapeSnapshotSteamAudio& shape = snapshot->shapes[sidx];
+            if (!shape.aabb.intersects_segment(from, segment_end)) {
+                continue;
+            }
+            Vector3 point, normal;
+            if (!shape.faces->intersect_segment(shape.inv_xform.xform(from), shape.inv_xform.xform(segment_end), point, normal)) {
+                continue;
+            }
+            closest = &shape;
+            segment_end = shape.xform.xform(point);
+            r_point = segment_end;
+            r_normal = shape.normal_basis.xform(normal).normalized();
+            if (any_hit) {
+                return closest;
+            }
+        }
+    }
+    return closest;
+}
+
+static void set_ray_segment_steamaudio(const IPLRay& ray, IPLfloat32 min_distance, IPLfloat32 max_distance, Vector3& from, Vector3& to) {
+    Vector3 origin = IPLVec3toGDVec3(ray.origin);
+    Vector3 direction = IPLVec3toGDVec3(ray.direction);
+    from = origin + direction * min_distance;
+    to = origin + direction * max_distance;
+}
+
+static void trace_closest_hit_steamaudio(const PhysicsSnapshotSteamAudio * snapshot, const IPLRay& ray, IPLfloat32 min_distance, IPLfloat32 max_distance, IPLHit& hit) {
+    hit.distance = INFINITY;
+    hit.triangleIndex = -1;
+    hit.objectIndex = -1;
+    hit.materialIndex = -1;
+    hit.material = nullptr;
+    if (snapshot == nullptr) {
+        return;
+    }
+
+    Vector3 from, to, point, normal;
+    set_ray_segment_steamaudio(ray, min_distance, max_distance, from, to);
+    const PhysicsShapeSnapshotSteamAudio * shape = intersect_snapshot_steamaudio(snapshot, from, to, point, normal, false);
+    if (shape == nullptr) {
+        return;
+    }
+    hit.distance = min_distance + from.distance_to(point);
+    hit.objectIndex = shape->object_index;
+    hit.materialIndex = 0;
+    hit.normal = GDVec3toIPLVec3(normal);
+    //Lives in the snapshot, which outlives every simulation that can see it
+    hit.material = const_cast<IPLMaterial *>(&shape->material);
+}
+
+static void trace_any_hit_steamaudio(const PhysicsSnapshotSteamAudio * snapshot, const IPLRay& ray, IPLfloat32 min_distance, IPLfloat32 max_distance, IPLuint8& occluded) {
+    occluded = 0;
+    if (snapshot == nullptr) {
+        return;
+    }
+
+    Vector3 from, to, point, normal;
+    set_ray_segment_steamaudio(ray, min_distance, max_distance, from, to);
+    occluded = intersect_snapshot_steamaudio(snapshot, from, to, point, normal, true) ? 1 : 0;
+}
+
+void physics_closest_hit_steamaudio(const IPLRay * ray, IPLfloat32 min_distance, IPLfloat32 max_distance, IPLHit * hit, void * user_data) {
+    trace_closest_hit_steamaudio(get_snapshot_steamaudio(user_data), *ray, min_distance, max_distance, *hit);
+}
+
+void physics_any_hit_steamaudio(const IPLRay * ray, IPLfloat32 min_distance, IPLfloat32 max_distance, IPLuint8 * occluded, void * user_data) {
+    trace_any_hit_steamaudio(get_snapshot_steamaudio(user_data), *ray, min_distance, max_distance, *occluded);
+}
+
+void physics_batched_closest_hit_steamaudio(IPLint32 num_rays, const IPLRay * rays, const IPLfloat32 * min_distances, const IPLfloat32 * max_distances, IPLHit * hits, void * user_data) {
+    const PhysicsSnapshotSteamAudio * snapshot = get_snapshot_steamaudio(user_data);
+    for (int ridx = 0; ridx < num_rays; ridx++) {
+        trace_closest_hit_steamaudio(snapshot, rays[ridx], min_distances[ridx], max_distances[ridx], hits[ridx]);
+    }
+}
+
+void physics_batched_any_hit_steamaudio(IPLint32 num_rays, const IPLRay * rays, const IPLfloat32 * min_distances, const IPLfloat32 * max_distances, IPLuint8 * occluded, void * user_data) {
+    const PhysicsSnapshotSteamAudio * snapshot = get_snapshot_steamaudio(user_data);
+    for (int ridx = 0; ridx < num_rays; ridx++) {
+        trace_any_hit_steamaudio(snapshot, rays[ridx], min_distances[ridx], max_distances[ridx], occluded[ridx]);
+    }
+}
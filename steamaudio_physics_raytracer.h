@@ -0,0 +1,92 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_PHYSICS_RAYTRACER_H
+#define STEAMAUDIO_PHYSICS_RAYTRACER_H
+
+#include "godot_steamaudio.h"
+#include "core/math/triangle_mesh.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/hash_set.h"
+
+#define PHYSICS_BVH_LEAF_SIZE_STEAMAUDIO 4
+#define PHYSICS_BVH_MAX_DEPTH_STEAMAUDIO 48
+
+//One collision shape of a physics body, copied out of the scene tree on the main thread
+struct PhysicsShapeSnapshotSteamAudio {
+    Ref<TriangleMesh> faces; //Shape space
+    Transform3D xform;
+    Transform3D inv_xform;
+    Basis normal_basis;
+    AABB aabb; //World space
+    IPLMaterial material;
+    IPLint32 object_index = -1;
+};
+
+//Bounding volume hierarchy over a snapshot's shapes. Leaves cover count shapes starting at first,
+//inner nodes have a count of 0 and their children at child and child + 1
+struct PhysicsBVHNodeSteamAudio {
+    AABB aabb;
+    uint32_t child = 0;
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+//Immutable once built, the callbacks only ever read the snapshot in GlobalStateSteamAudio::physics_snapshot
+struct PhysicsSnapshotSteamAudio {
+    LocalVector<PhysicsShapeSnapshotSteamAudio> shapes; //In BVH order
+    LocalVector<PhysicsBVHNodeSteamAudio> nodes;
+};
+
+struct PhysicsShapeCacheEntrySteamAudio {
+    Ref<TriangleMesh> faces;
+    Vector3 params;
+    const void * data = nullptr;
+    int64_t data_size = 0;
+};
+
+//Kept across snapshots so unchanged shapes aren't rebuilt and each body keeps its object index.
+//bodies holds every physics body in the tree, kept up to date from the SceneTree's node signals
+struct PhysicsSnapshotCacheSteamAudio {
+    HashMap<ObjectID, PhysicsShapeCacheEntrySteamAudio> shapes;
+    HashMap<ObjectID, IPLint32> object_indices;
+    IPLint32 next_object_index = 0;
+    HashSet<ObjectID> bodies;
+    LocalVector<PhysicsShapeSnapshotSteamAudio> last_shapes;
+};
+
+//Main thread only. Seeds cache.bodies with the physics bodies under root, later ones come from track_physics_node_steamaudio()
+void collect_physics_bodies_steamaudio(Node * root, PhysicsSnapshotCacheSteamAudio& cache);
+void track_physics_node_steamaudio(Node * node, bool in_tree, PhysicsSnapshotCacheSteamAudio& cache);
+//Main thread only, reads the tracked bodies that live in world. Returns nullptr when nothing moved or changed since the last snapshot
+PhysicsSnapshotSteamAudio * build_physics_snapshot_steamaudio(const Ref<World3D>& world, PhysicsSnapshotCacheSteamAudio& cache);
+
+//IPL_SCENETYPE_CUSTOM callbacks tracing against GlobalStateSteamAudio::physics_snapshot, userData is the GlobalStateSteamAudio.
+//The snapshot is only replaced at the scene commit point, when no simulation is running
+void physics_closest_hit_steamaudio(const IPLRay * ray, IPLfloat32 min_distance, IPLfloat32 max_distance, IPLHit * hit, void * user_data);
+void physics_any_hit_steamaudio(const IPLRay * ray, IPLfloat32 min_distance, IPLfloat32 max_distance, IPLuint8 * occluded, void * user_data);
+void physics_batched_closest_hit_steamaudio(IPLint32 num_rays, const IPLRay * rays, const IPLfloat32 * min_distances, const IPLfloat32 * max_distances, IPLHit * hits, void * user_data);
+void physics_batched_any_hit_steamaudio(IPLint32 num_rays, const IPLRay * rays, const IPLfloat32 * min_distances, const IPLfloat32 * max_distances, IPLuint8 * occluded, void * user_data);
+
+#endif // STEAMAUDIO_PHYSICS_RAYTRACER_H
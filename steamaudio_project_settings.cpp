@@ -0,0 +1,134 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "godot_steamaudio.h"
+#include "core/config/project_settings.h"
+#include "core/io/dir_access.h"
+#include "core/os/os.h"
+#include "steamaudio_physics_raytracer.h"
+#include <stdio.h>
+
+//Everything that reads the project or touches the engine lives here, so godot_steamaudio.cpp
+//can be linked into the headless steamaudio_bench program on its own
+
+int load_global_settings_steamaudio(GlobalStateSteamAudio& global_state) {
+    float mix_rate = GLOBAL_GET("audio/driver/mix_rate");
+    int latency = GLOBAL_GET("audio/driver/output_latency"); 
+    unsigned int buffer_size = closest_power_of_2(latency * mix_rate / 1000);
+    printf("mix_rate %f latency %d buffer_size %u\n", mix_rate, latency, buffer_size);   
+    default_global_settings_steamaudio(global_state, mix_rate, buffer_size);
+
+    //SteamAudioServer.benchmark_raytracers() compares Embree and the built-in tracer on this machine
+    global_state.raytracer = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/raytracer", PROPERTY_HINT_ENUM, "Embree,Physics Server,Default"), RAYTRACER_EMBREE_STEAMAUDIO);
+    if (global_state.raytracer == RAYTRACER_DEFAULT_STEAMAUDIO) {
+        global_state.scene_settings.type = IPL_SCENETYPE_DEFAULT;
+        global_state.use_radeon_rays = false;
+    } else if (global_state.raytracer == RAYTRACER_PHYSICS_STEAMAUDIO) {
+        //Occluders come from the collision shapes already in the physics world
+        global_state.scene_settings.type = IPL_SCENETYPE_CUSTOM;
+        global_state.use_radeon_rays = false;
+        global_state.scene_settings.closestHitCallback = physics_closest_hit_steamaudio;
+        global_state.scene_settings.anyHitCallback = physics_any_hit_steamaudio;
+        global_state.scene_settings.batchedClosestHitCallback = physics_batched_closest_hit_steamaudio;
+        global_state.scene_settings.batchedAnyHitCallback = physics_batched_any_hit_steamaudio;
+        global_state.scene_settings.userData = &global_state;
+    }
+    //The physics raytracer traces a copy of the collision shapes, this is how often it is refreshed
+    float physics_snapshot_interval = GLOBAL_DEF(PropertyInfo(Variant::FLOAT, "steamaudio/physics_snapshot_interval", PROPERTY_HINT_RANGE, "0,1,0.01,suffix:s"), 0.1f);
+    global_state.physics_snapshot_interval_usec = (uint64_t)(MAX(physics_snapshot_interval, 0.0f) * 1000000.0f);
+
+    //The tier picks the simulation budget, each override above 0 replaces one value of it
+    int quality_tier = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/quality/tier", PROPERTY_HINT_ENUM, "Low,Medium,High,Ultra"), QUALITY_TIER_HIGH_STEAMAUDIO);
+    QualitySettingsSteamAudio quality = quality_preset_steamaudio(quality_tier);
+    int ambisonics_order = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/quality/ambisonics_order", PROPERTY_HINT_RANGE, "0,3,1"), 0);
+    int max_num_rays = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/quality/max_num_rays", PROPERTY_HINT_RANGE, "0,16384,1"), 0);
+    int num_diffuse_samples = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/quality/num_diffuse_samples", PROPERTY_HINT_RANGE, "0,256,1"), 0);
+    float max_duration = GLOBAL_DEF_RST(PropertyInfo(Variant::FLOAT, "steamaudio/quality/max_duration", PROPERTY_HINT_RANGE, "0,4,0.1,suffix:s"), 0.0f);
+    int max_num_sources = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/quality/max_num_sources", PROPERTY_HINT_RANGE, "0,1024,1"), 0);
+    int num_bounces = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/quality/num_bounces", PROPERTY_HINT_RANGE, "0,64,1"), 0);
+    if (ambisonics_order > 0) {
+        quality.ambisonics_order = ambisonics_order;
+    }
+    if (max_num_rays > 0) {
+        quality.max_num_rays = max_num_rays;
+    }
+    if (num_diffuse_samples > 0) {
+        quality.num_diffuse_samples = num_diffuse_samples;
+    }
+    if (max_duration > 0.0f) {
+        quality.max_duration = max_duration;
+    }
+    if (max_num_sources > 0) {
+        quality.max_num_sources = max_num_sources;
+    }
+    if (num_bounces > 0) {
+        quality.num_bounces = num_bounces;
+    }
+    apply_quality_settings_steamaudio(global_state, quality);
+
+    //0 means one thread per core left over after the engine's reserved cores
+    int num_threads = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/simulation/num_threads", PROPERTY_HINT_RANGE, "0,64,1"), 0);
+    if (num_threads <= 0) {
+        int reserved_cores = GLOBAL_GET("steamaudio/simulation/reserved_cores");
+        num_threads = MAX(1, OS::get_singleton()->get_processor_count() - reserved_cores);
+    }
+    global_state.sim_settings.numThreads = num_threads;
+
+    //Players can pick another type per source only when the simulator is hybrid, it is the only one producing both the IR and the parametric reverb
+    int reflection_type = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/simulation/reflection_type", PROPERTY_HINT_ENUM, "Convolution,Parametric,Hybrid"), IPL_REFLECTIONEFFECTTYPE_CONVOLUTION);
+    global_state.sim_settings.reflectionType = (IPLReflectionEffectType)reflection_type;
+    global_state.hybrid_transition_time = GLOBAL_DEF_RST(PropertyInfo(Variant::FLOAT, "steamaudio/simulation/hybrid_transition_time", PROPERTY_HINT_RANGE, "0.1,4,0.05,suffix:s"), 1.0f);
+    float hybrid_overlap_percent = GLOBAL_DEF_RST(PropertyInfo(Variant::FLOAT, "steamaudio/simulation/hybrid_overlap_percent", PROPERTY_HINT_RANGE, "0,100,1,suffix:%"), 25.0f);
+    global_state.hybrid_overlap = hybrid_overlap_percent / 100.0f;
+
+    global_state.use_mesh_cache = GLOBAL_DEF("steamaudio/geometry/use_mesh_cache", false);
+    global_state.mesh_cache_path = GLOBAL_DEF("steamaudio/geometry/mesh_cache_path", "user://steamaudio_mesh_cache");
+    int mesh_cache_max_size_mb = GLOBAL_DEF(PropertyInfo(Variant::INT, "steamaudio/geometry/mesh_cache_max_size_mb", PROPERTY_HINT_RANGE, "0,4096,1,or_greater,suffix:MiB"), 256);
+    global_state.mesh_cache_max_size = (uint64_t)MAX(mesh_cache_max_size_mb, 0) * 1024 * 1024;
+    if (global_state.use_mesh_cache) {
+        String cache_dir = ProjectSettings::get_singleton()->globalize_path(global_state.mesh_cache_path);
+        if (DirAccess::make_dir_recursive_absolute(cache_dir) != OK) {
+            printf("Could not create mesh cache dir %s, cache is read-only\n", cache_dir.utf8().get_data());
+        }
+    }
+
+    global_state.simplify_geometry = GLOBAL_DEF("steamaudio/geometry/simplify", false);
+    global_state.simplify_tolerance = GLOBAL_DEF("steamaudio/geometry/simplify_tolerance", 0.1f);
+    global_state.simplify_min_feature_size = GLOBAL_DEF("steamaudio/geometry/simplify_min_feature_size", 0.25f);
+
+    global_state.pose_extrapolation.store(GLOBAL_DEF("steamaudio/simulation/pose_extrapolation", true));
+    float max_extrapolation_ms = GLOBAL_DEF("steamaudio/simulation/max_extrapolation_ms", 50.0f);
+    global_state.max_extrapolation_usec = (uint64_t)(max_extrapolation_ms * 1000.0f);
+    global_state.output_latency_usec = (uint64_t)latency * 1000;
+
+    return 0;
+}
+
+int init_global_state_steamaudio(GlobalStateSteamAudio& global_state) {
+    int error_code = load_global_settings_steamaudio(global_state);
+    if (error_code) {
+        return error_code;
+    }
+    return create_global_state_steamaudio(global_state);
+}
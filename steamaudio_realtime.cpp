@@ -0,0 +1,174 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_realtime.h"
+#include "steamaudio_lockfree.h"
+#include <stdio.h>
+
+struct RealtimeSiteSteamAudio {
+    std::atomic<const char *> site = nullptr;
+    std::atomic<uint64_t> count = 0;
+    bool reported = false;
+};
+
+static RealtimeSiteSteamAudio realtime_sites_steamaudio[MAX_REALTIME_SITES_STEAMAUDIO];
+static std::atomic<uint64_t> realtime_violations_steamaudio = 0;
+
+#ifdef DEBUG_ENABLED
+static thread_local bool audio_thread_scope_tls_steamaudio = false;
+
+AudioThreadScopeSteamAudio::AudioThreadScopeSteamAudio() {
+    previous = audio_thread_scope_tls_steamaudio;
+    audio_thread_scope_tls_steamaudio = true;
+}
+
+AudioThreadScopeSteamAudio::~AudioThreadScopeSteamAudio() {
+    audio_thread_scope_tls_steamaudio = previous;
+}
+
+//Lock-free so reporting a violation doesn't add another one
+void check_realtime_steamaudio(const char * site) {
+    if (!audio_thread_scope_tls_steamaudio) {
+        return;
+    }
+    realtime_violations_steamaudio.fetch_add(1, std::memory_order_relaxed);
+    for (RealtimeSiteSteamAudio& slot : realtime_sites_steamaudio) {
+        const char * current = slot.site.load(std::memory_order_acquire);
+        if (current == nullptr) {
+            if (slot.site.compare_exchange_strong(current, site, std::memory_order_acq_rel)) {
+                current = site;
+            }
+        }
+        if (current == site) {
+            slot.count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+#endif
+
+uint64_t get_realtime_violations_steamaudio() {
+    return realtime_violations_steamaudio.load(std::memory_order_relaxed);
+}
+
+//Called from the main thread only, which owns the reported flags
+int get_realtime_sites_steamaudio(const char ** sites, uint64_t * counts, int max_sites) {
+    int num_sites = 0;
+    for (RealtimeSiteSteamAudio& slot : realtime_sites_steamaudio) {
+        const char * site = slot.site.load(std::memory_order_acquire);
+        if (site == nullptr || num_sites >= max_sites) {
+            break;
+        }
+        uint64_t count = slot.count.load(std::memory_order_relaxed);
+        if (!slot.reported) {
+            printf("Real-time violation on the audio thread: %s\n", site);
+            slot.reported = true;
+        }
+        sites[num_sites] = site;
+        counts[num_sites] = count;
+        num_sites++;
+    }
+    return num_sites;
+}
+
+struct LockSiteSteamAudio {
+    std::atomic<const char *> site = nullptr;
+    std::atomic<uint64_t> acquisitions = 0;
+    std::atomic<uint64_t> wait_usec = 0;
+    std::atomic<uint64_t> max_wait_usec = 0;
+    std::atomic<uint64_t> hold_usec = 0;
+    std::atomic<uint64_t> max_hold_usec = 0;
+};
+
+static LockSiteSteamAudio lock_sites_steamaudio[MAX_LOCK_SITES_STEAMAUDIO];
+static std::atomic<uint64_t> lock_window_wait_usec_steamaudio = 0;
+static std::atomic<uint64_t> lock_window_hold_usec_steamaudio = 0;
+
+static void store_max_steamaudio(std::atomic<uint64_t>& max_value, uint64_t value) {
+    uint64_t current = max_value.load(std::memory_order_relaxed);
+    while (value > current && !max_value.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+LockTimerSteamAudio::LockTimerSteamAudio(const char * p_site) {
+    site = p_site;
+    request_usec = ticks_usec_steamaudio();
+}
+
+void LockTimerSteamAudio::acquired() {
+    acquired_usec = ticks_usec_steamaudio();
+}
+
+//A timer whose lock was never taken records nothing
+LockTimerSteamAudio::~LockTimerSteamAudio() {
+    if (acquired_usec == 0) {
+        return;
+    }
+    record_lock_steamaudio(site, acquired_usec - request_usec, ticks_usec_steamaudio() - acquired_usec);
+}
+
+//Lock-free, like the real-time sites, so timing a lock doesn't take another one
+void record_lock_steamaudio(const char * site, uint64_t wait_usec, uint64_t hold_usec) {
+    store_max_steamaudio(lock_window_wait_usec_steamaudio, wait_usec);
+    store_max_steamaudio(lock_window_hold_usec_steamaudio, hold_usec);
+    for (LockSiteSteamAudio& slot : lock_sites_steamaudio) {
+        const char * current = slot.site.load(std::memory_order_acquire);
+        if (current == nullptr) {
+            if (slot.site.compare_exchange_strong(current, site, std::memory_order_acq_rel)) {
+                current = site;
+            }
+        }
+        if (current == site) {
+            slot.acquisitions.fetch_add(1, std::memory_order_relaxed);
+            slot.wait_usec.fetch_add(wait_usec, std::memory_order_relaxed);
+            slot.hold_usec.fetch_add(hold_usec, std::memory_order_relaxed);
+            store_max_steamaudio(slot.max_wait_usec, wait_usec);
+            store_max_steamaudio(slot.max_hold_usec, hold_usec);
+            return;
+        }
+    }
+}
+
+int get_lock_sites_steamaudio(const char ** sites, LockStatsSteamAudio * stats, int max_sites) {
+    int num_sites = 0;
+    for (LockSiteSteamAudio& slot : lock_sites_steamaudio) {
+        const char * site = slot.site.load(std::memory_order_acquire);
+        if (site == nullptr || num_sites >= max_sites) {
+            break;
+        }
+        sites[num_sites] = site;
+        stats[num_sites].acquisitions = slot.acquisitions.load(std::memory_order_relaxed);
+        stats[num_sites].wait_usec = slot.wait_usec.load(std::memory_order_relaxed);
+        stats[num_sites].max_wait_usec = slot.max_wait_usec.load(std::memory_order_relaxed);
+        stats[num_sites].hold_usec = slot.hold_usec.load(std::memory_order_relaxed);
+        stats[num_sites].max_hold_usec = slot.max_hold_usec.load(std::memory_order_relaxed);
+        num_sites++;
+    }
+    return num_sites;
+}
+
+void take_lock_window_steamaudio(uint64_t& max_wait_usec, uint64_t& max_hold_usec) {
+    max_wait_usec = lock_window_wait_usec_steamaudio.exchange(0, std::memory_order_relaxed);
+    max_hold_usec = lock_window_hold_usec_steamaudio.exchange(0, std::memory_order_relaxed);
+}
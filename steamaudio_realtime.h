@@ -0,0 +1,88 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_REALTIME_H
+#define STEAMAUDIO_REALTIME_H
+
+#include "core/typedefs.h"
+#include <atomic>
+
+#define MAX_REALTIME_SITES_STEAMAUDIO 32
+#define MAX_LOCK_SITES_STEAMAUDIO 32
+
+//Steam Audio's allocator callbacks call REALTIME_UNSAFE_STEAMAUDIO(site) first. In debug builds,
+//reaching one inside an AUDIO_THREAD_SCOPE_STEAMAUDIO() counts a violation against that site.
+//Sites are string literals, the first MAX_REALTIME_SITES_STEAMAUDIO distinct ones are kept
+#ifdef DEBUG_ENABLED
+struct AudioThreadScopeSteamAudio {
+    bool previous;
+    AudioThreadScopeSteamAudio();
+    ~AudioThreadScopeSteamAudio();
+};
+
+void check_realtime_steamaudio(const char * site);
+
+#define AUDIO_THREAD_SCOPE_STEAMAUDIO() AudioThreadScopeSteamAudio audio_thread_scope_steamaudio
+#define REALTIME_UNSAFE_STEAMAUDIO(site) check_realtime_steamaudio(site)
+#else
+#define AUDIO_THREAD_SCOPE_STEAMAUDIO() ((void)0)
+#define REALTIME_UNSAFE_STEAMAUDIO(site) ((void)0)
+#endif
+
+//Always zero in release builds
+uint64_t get_realtime_violations_steamaudio();
+//Fills up to max_sites sites, returns how many were written. Sites not yet reported are printed once
+int get_realtime_sites_steamaudio(const char ** sites, uint64_t * counts, int max_sites);
+
+//Module code that takes state_mtx or the AudioServer lock off the simulation threads times how long it
+//waited for the lock and how long it then held it, accumulated per site:
+//    LockTimerSteamAudio lock_timer("state_mtx: SteamAudioServer::tick");
+//    std::unique_lock<std::mutex> lock(state_mtx);
+//    lock_timer.acquired();
+//Hold time runs until the timer goes out of scope, so it is declared before the lock it measures.
+//Sites are string literals, the first MAX_LOCK_SITES_STEAMAUDIO distinct ones are kept
+struct LockTimerSteamAudio {
+    const char * site;
+    uint64_t request_usec;
+    uint64_t acquired_usec = 0;
+    explicit LockTimerSteamAudio(const char * p_site);
+    void acquired();
+    ~LockTimerSteamAudio();
+};
+
+struct LockStatsSteamAudio {
+    uint64_t acquisitions = 0;
+    uint64_t wait_usec = 0;
+    uint64_t max_wait_usec = 0;
+    uint64_t hold_usec = 0;
+    uint64_t max_hold_usec = 0;
+};
+
+void record_lock_steamaudio(const char * site, uint64_t wait_usec, uint64_t hold_usec);
+//Fills up to max_sites sites, returns how many were written
+int get_lock_sites_steamaudio(const char ** sites, LockStatsSteamAudio * stats, int max_sites);
+//Longest wait and hold at any site since the last call, for the windowed monitors
+void take_lock_window_steamaudio(uint64_t& max_wait_usec, uint64_t& max_hold_usec);
+
+#endif // STEAMAUDIO_REALTIME_H
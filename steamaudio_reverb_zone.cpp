@@ -0,0 +1,87 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_reverb_zone.h"
+#include "steamaudio_server.h"
+
+SteamAudioReverbZone::SteamAudioReverbZone() {
+    set_notify_transform(true);
+}
+
+SteamAudioReverbZone::~SteamAudioReverbZone() {
+}
+
+void SteamAudioReverbZone::set_size(const Vector3& p_size) {
+    size = p_size.abs();
+}
+
+Vector3 SteamAudioReverbZone::get_size() const {
+    return size;
+}
+
+void SteamAudioReverbZone::set_reverb_time(float p_reverb_time) {
+    reverb_time = MAX(p_reverb_time, 0.0f);
+}
+
+float SteamAudioReverbZone::get_reverb_time() const {
+    return reverb_time;
+}
+
+//Called by the server from tick(), p_point is in global space and p_margin grows the box in its local space
+bool SteamAudioReverbZone::has_point(const Vector3& p_point, float p_margin) const {
+    Vector3 local_point = inverse_transform.xform(p_point);
+    return AABB(-size * 0.5f, size).grow(p_margin).has_point(local_point);
+}
+
+//Nested zones are resolved by volume, the smallest zone containing a source wins
+float SteamAudioReverbZone::get_volume() const {
+    return size.x * size.y * size.z;
+}
+
+void SteamAudioReverbZone::_notification(int p_what) {
+    switch (p_what) {
+        case NOTIFICATION_ENTER_TREE: {
+            inverse_transform = get_global_transform().affine_inverse();
+            SteamAudioServer::get_singleton()->add_reverb_zone(this);
+        } break;
+
+        case NOTIFICATION_TRANSFORM_CHANGED: {
+            inverse_transform = get_global_transform().affine_inverse();
+        } break;
+
+        case NOTIFICATION_EXIT_TREE: {
+            SteamAudioServer::get_singleton()->remove_reverb_zone(this);
+        } break;
+    }
+}
+
+void SteamAudioReverbZone::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_size", "size"), &SteamAudioReverbZone::set_size);
+	ClassDB::bind_method(D_METHOD("get_size"), &SteamAudioReverbZone::get_size);
+	ClassDB::bind_method(D_METHOD("set_reverb_time", "reverb_time"), &SteamAudioReverbZone::set_reverb_time);
+	ClassDB::bind_method(D_METHOD("get_reverb_time"), &SteamAudioReverbZone::get_reverb_time);
+
+	ADD_PROPERTY(PropertyInfo(Variant::VECTOR3, "size", PROPERTY_HINT_NONE, "suffix:m"), "set_size", "get_size");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "reverb_time", PROPERTY_HINT_RANGE, "0,10,0.01,suffix:s"), "set_reverb_time", "get_reverb_time");
+}
@@ -0,0 +1,51 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_REVERB_ZONE_H
+#define STEAMAUDIO_REVERB_ZONE_H
+
+#include "scene/3d/node_3d.h"
+
+//A box, centered on the node, in which sources use reverb_time as their reflection IR length
+class SteamAudioReverbZone : public Node3D {
+    GDCLASS(SteamAudioReverbZone, Node3D);
+public:
+    SteamAudioReverbZone();
+    ~SteamAudioReverbZone();
+    void set_size(const Vector3& p_size);
+    Vector3 get_size() const;
+    void set_reverb_time(float p_reverb_time);
+    float get_reverb_time() const;
+    bool has_point(const Vector3& p_point, float p_margin = 0.0f) const;
+    float get_volume() const;
+protected:
+    void _notification(int p_what);
+    static void _bind_methods();
+private:
+    Vector3 size = Vector3(10.0f, 10.0f, 10.0f);
+    float reverb_time = 1.0f;
+    Transform3D inverse_transform;
+};
+
+#endif // STEAMAUDIO_REVERB_ZONE_H
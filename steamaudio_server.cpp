@@ -24,9 +24,49 @@ SOFTWARE.
 
 #include "steamaudio_server.h"
 #include "audio_stream_player_steamaudio.h"
+#include "audio_stream_steamaudio.h"
+#include "steamaudio_settings.h"
+#include "steamaudio_geometry.h"
+#include "steamaudio_instanced_geometry.h"
+#include "steamaudio_reverb_zone.h"
+#include "steamaudio_benchmark.h"
+#include "steamaudio_trace.h"
+#include "steamaudio_capture.h"
+#include "steamaudio_realtime.h"
+#include "steamaudio_memory.h"
+#include "core/config/project_settings.h"
+#include "core/os/os.h"
+#include "scene/resources/audio_stream_wav.h"
+#include "servers/audio_server.h"
+#include "main/performance.h"
+#include "scene/main/scene_tree.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
 
 void SteamAudioServer::_bind_methods() {
     ClassDB::bind_method(D_METHOD("tick"), &SteamAudioServer::tick);
+    ClassDB::bind_method(D_METHOD("get_geometry_stats"), &SteamAudioServer::get_geometry_stats);
+    ClassDB::bind_method(D_METHOD("get_simulation_stats"), &SteamAudioServer::get_simulation_stats);
+    ClassDB::bind_method(D_METHOD("get_memory_usage"), &SteamAudioServer::get_memory_usage);
+    ClassDB::bind_method(D_METHOD("get_sources_in_radius", "center", "radius"), &SteamAudioServer::get_sources_in_radius);
+    ClassDB::bind_method(D_METHOD("get_nearest_sources", "center", "count"), &SteamAudioServer::get_nearest_sources);
+    ClassDB::bind_method(D_METHOD("render_offline", "path", "duration"), &SteamAudioServer::render_offline);
+    ClassDB::bind_method(D_METHOD("start_trace", "path"), &SteamAudioServer::start_trace);
+    ClassDB::bind_method(D_METHOD("stop_trace"), &SteamAudioServer::stop_trace);
+    ClassDB::bind_method(D_METHOD("start_capture", "path"), &SteamAudioServer::start_capture);
+    ClassDB::bind_method(D_METHOD("stop_capture"), &SteamAudioServer::stop_capture);
+    ClassDB::bind_method(D_METHOD("replay_capture", "path", "wav_path"), &SteamAudioServer::replay_capture, DEFVAL(""));
+    ClassDB::bind_method(D_METHOD("set_settings", "settings"), &SteamAudioServer::set_settings);
+    ClassDB::bind_method(D_METHOD("get_settings"), &SteamAudioServer::get_settings);
+    ClassDB::bind_method(D_METHOD("benchmark_raytracers", "subdivisions", "iterations"), &SteamAudioServer::benchmark_raytracers, DEFVAL(16), DEFVAL(4));
+
+    ADD_SIGNAL(MethodInfo("settings_applied"));
 }
 
 void SteamAudioServer::tick() {
@@ -34,35 +74,131 @@ void SteamAudioServer::tick() {
     if (!global_state_initialized.load())
         return;
 
+    if (quality_swap_ready.load()) {
+        apply_quality_swap();
+    }
+
     if (listener==nullptr)
         return;
 
+    if (!monitors_registered && Performance::get_singleton()) {
+        register_monitors();
+    }
 
-    //We should only update the scene and simulator if neither simulation is running
-    //this function blocks until the direct simulation finished
-    //so we only have to check if the indirect thread is still running
-    if (!indirect_thread_processing.load()) {
-        iplSceneCommit(global_state.scene);
-        iplSimulatorSetScene(global_state.simulator, global_state.scene);
-        iplSimulatorCommit(global_state.simulator);
+    uint64_t tick_start_usec = ticks_usec_steamaudio();
+    Vector<GeometryCommitSteamAudio> geometry_committed;
+    if (global_state.raytracer == RAYTRACER_PHYSICS_STEAMAUDIO && listener->is_inside_tree()) {
+        update_physics_snapshot(tick_start_usec);
+    }
+    {
+        TRACE_SCOPE_STEAMAUDIO("tick");
+        //Holding state_mtx keeps the scheduler out while the scene is committed and poses are published
+        LockTimerSteamAudio lock_timer("state_mtx: SteamAudioServer::tick");
+        std::unique_lock<std::mutex> lock(state_mtx);
+        lock_timer.acquired();
+
+        //We should only update the scene and simulator if neither simulation is running,
+        //the scheduler drops state_mtx during its direct pass so that has to be checked too
+        if (!indirect_thread_processing.load() && !direct_processing) {
+            TRACE_SCOPE_STEAMAUDIO("scene_commit");
+            MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SCENE_STEAMAUDIO);
+            commit_geometry_jobs(geometry_committed);
+            //Nothing is tracing right now, so the old snapshot can go
+            if (pending_physics_snapshot) {
+                if (global_state.physics_snapshot) {
+                    memdelete(global_state.physics_snapshot);
+                }
+                global_state.physics_snapshot = pending_physics_snapshot;
+                pending_physics_snapshot = nullptr;
+            }
+            for (SteamAudioInstancedGeometry * instance : dynamic_instances) {
+                instance->update_instance_transform();
+            }
+            iplSceneCommit(global_state.scene);
+            iplSimulatorSetScene(global_state.simulator, global_state.scene);
+            iplSimulatorCommit(global_state.simulator);
+            recycle_returned_sources();
+        }
+
+        Vector3 listener_pos = listener->get_global_transform().origin;
+        //https://docs.godotengine.org/en/stable/classes/class_basis.html#class-basis-operator-idx-int
+        //Access basis components using their index. b[0] is equivalent to b.x, b[1] is equivalent to b.y, and b[2] is equivalent to b.z.
+        Vector3 listener_ahead = -listener->get_global_transform().get_basis().get_column(2); //z
+        Vector3 listener_up = listener->get_global_transform().get_basis().get_column(1);     //y
+        Vector3 listener_right = listener->get_global_transform().get_basis().get_column(0);  //x
+        published_listener.ahead = GDVec3toIPLVec3(listener_ahead);
+        published_listener.up = GDVec3toIPLVec3(listener_up);
+        published_listener.right = GDVec3toIPLVec3(listener_right);
+        published_listener.origin = GDVec3toIPLVec3(listener_pos);
+        uint64_t pose_usec = ticks_usec_steamaudio();
+        published_usec = pose_usec;
+        global_state.listener_poses.push(pose_usec, published_listener);
+        for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
+            local_state->published_source_pos = local_state->source.steamaudio_player->get_global_transform().origin;
+            source_index.update(local_state->source_index_handle, local_state->published_source_pos);
+            local_state->setting_ir_duration.store(get_ir_duration(local_state), std::memory_order_relaxed);
+            //Sources have no orientation yet, identity axes keep the extrapolated rotation at zero
+            IPLCoordinateSpace3 source_pose{};
+            source_pose.right = IPLVector3{1.0f,0.0f,0.0f};
+            source_pose.up = IPLVector3{0.0f,1.0f,0.0f};
+            source_pose.ahead = IPLVector3{0.0f,0.0f,-1.0f};
+            source_pose.origin = GDVec3toIPLVec3(local_state->published_source_pos);
+            local_state->source_poses.push(pose_usec, source_pose);
+        }
+        poses_published = true;
+        if (capture_file.is_valid()) {
+            capture_tick();
+        }
+
+        //Without a scheduler the simulation runs at the rate tick() is called
+        if (direct_rate <= 0.0f) {
+            run_direct_simulation();
+            run_reflection_simulation();
+        }
+
+        if (pose_usec - monitor_window_start_usec >= MONITOR_WINDOW_USEC_STEAMAUDIO) {
+            update_monitor_window(pose_usec);
+        }
     }
+    global_state.stats.tick_usec.store(ticks_usec_steamaudio() - tick_start_usec);
 
-    Vector3 listener_pos = listener->get_global_transform().origin;
-    //https://docs.godotengine.org/en/stable/classes/class_basis.html#class-basis-operator-idx-int
-    //Access basis components using their index. b[0] is equivalent to b.x, b[1] is equivalent to b.y, and b[2] is equivalent to b.z.
-    Vector3 listener_ahead = -listener->get_global_transform().get_basis().get_column(2); //z
-    Vector3 listener_up = listener->get_global_transform().get_basis().get_column(1);     //y
-    Vector3 listener_right = listener->get_global_transform().get_basis().get_column(0);  //x
-    IPLCoordinateSpace3 listener_coordinates;
-    listener_coordinates.ahead = GDVec3toIPLVec3(listener_ahead);
-    listener_coordinates.up = GDVec3toIPLVec3(listener_up);
-    listener_coordinates.right = GDVec3toIPLVec3(listener_right);
-    listener_coordinates.origin = GDVec3toIPLVec3(listener_pos);
+    for (const GeometryCommitSteamAudio &commit : geometry_committed) {
+        //Re-resolve, an earlier handler may have freed this node
+        Object * owner = ObjectDB::get_instance(commit.owner_id);
+        if (!owner) {
+            continue;
+        }
+        if (commit.error_code) {
+            owner->emit_signal(SNAME("geometry_failed"), commit.error_code);
+        } else {
+            owner->emit_signal(SNAME("geometry_ready"));
+        }
+    }
+}
 
-    for (LocalStateSteamAudio * local_state : local_states) {
+//Caller holds state_mtx and keeps it through the pass, for callers that already own every thread
+void SteamAudioServer::run_direct_simulation() {
+    prepare_direct_simulation();
+    {
+        TRACE_SCOPE_STEAMAUDIO("run_direct");
+        iplSimulatorRunDirect(global_state.simulator);
+    }
+    publish_direct_simulation();
+}
+
+//Caller holds state_mtx. Copies everything the pass reads, so the lock can be dropped while it runs
+void SteamAudioServer::prepare_direct_simulation() {
+    direct_start_usec = ticks_usec_steamaudio();
+    direct_processing = true;
+    direct_listener = published_listener;
+    //Results are stamped with the time of the poses they were simulated from
+    direct_pose_usec = published_usec;
+    Vector3 listener_pos = IPLVec3toGDVec3(direct_listener.origin);
+
+    for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
         IPLDistanceAttenuationModel distance_attenuation_model{};
         distance_attenuation_model.type = IPL_DISTANCEATTENUATIONTYPE_DEFAULT;
-        Vector3 source_pos = local_state->source.steamaudio_player->get_global_transform().origin;
+        Vector3 source_pos = local_state->published_source_pos;
         float _distance_attenuation = iplDistanceAttenuationCalculate(global_state.phonon_ctx, 
                                                                       GDVec3toIPLVec3(source_pos), 
                                                                       GDVec3toIPLVec3(listener_pos), 
@@ -85,82 +221,305 @@ void SteamAudioServer::tick() {
         inputs.occlusionRadius = local_state->setting_occlusion_radius;
         inputs.numOcclusionSamples = local_state->setting_occlusion_num_samples;
         iplSourceSetInputs(local_state->source.src, IPL_SIMULATIONFLAGS_DIRECT, &inputs);
-
+        local_state->sim_outputs.direct_sim_started = true;
     }
 
 
     IPLSimulationSharedInputs shared_inputs{};
-    shared_inputs.listener = listener_coordinates;
+    shared_inputs.listener = direct_listener;
 
     iplSimulatorSetSharedInputs(global_state.simulator, IPL_SIMULATIONFLAGS_DIRECT, &shared_inputs);
-    iplSimulatorRunDirect(global_state.simulator);
-
-    for (LocalStateSteamAudio * local_state : local_states) {
-        //Write outputs
-        SimOutputsSteamAudio * sim_outputs = &(local_state->sim_outputs);
-        int dir_wr_idx = get_write_direct_idx(sim_outputs);
-        int dir_rd_idx = get_read_direct_idx(sim_outputs);
+}
 
-        sim_outputs->direct_outputs[dir_wr_idx].distance_attenuation = local_state->distance_attenuation_cache;
-        sim_outputs->direct_outputs[dir_wr_idx].listener_orientation = listener_coordinates;
-        sim_outputs->direct_outputs[dir_wr_idx].listener_orientation.origin = IPLVector3{0.0f,0.0f,0.0f};
-        sim_outputs->direct_outputs[dir_wr_idx].ambisonics_direction = GDVec3toIPLVec3(local_state->ambisonics_direction_cache.normalized());
-        iplSourceGetOutputs(local_state->source.src, IPL_SIMULATIONFLAGS_DIRECT, &(sim_outputs->direct_outputs[dir_wr_idx].direct_sim_outputs));
-        sim_outputs->direct_valid[dir_wr_idx].store(true);
+//Caller holds state_mtx. Sources removed during the pass are gone from the index, ones added during it weren't simulated
+void SteamAudioServer::publish_direct_simulation() {
+    uint64_t sim_usec = direct_pose_usec;
 
-        bool read_direct_valid = sim_outputs->direct_valid[dir_rd_idx].load();
-        bool direct_read_done = sim_outputs->direct_read_done.load();
-        if (!read_direct_valid || direct_read_done) {
-            sim_outputs->direct_idx.store(1-sim_outputs->direct_idx.load());
-            sim_outputs->direct_read_done.store(false);
+    for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
+        if (!local_state->sim_outputs.direct_sim_started) {
+            continue;
         }
+        local_state->sim_outputs.direct_sim_started = false;
+        //Write outputs
+        DirectOutputsSteamAudio& direct_outputs = local_state->sim_outputs.direct.write_slot();
+        direct_outputs.distance_attenuation = local_state->distance_attenuation_cache;
+        direct_outputs.listener_orientation = direct_listener;
+        direct_outputs.listener_orientation.origin = IPLVector3{0.0f,0.0f,0.0f};
+        direct_outputs.ambisonics_direction = GDVec3toIPLVec3(local_state->ambisonics_direction_cache.normalized());
+        iplSourceGetOutputs(local_state->source.src, IPL_SIMULATIONFLAGS_DIRECT, &(direct_outputs.direct_sim_outputs));
+        local_state->sim_outputs.direct.publish(sim_usec);
     }
+    global_state.stats.direct_usec.store(ticks_usec_steamaudio() - direct_start_usec);
+    direct_processing = false;
+    direct_cv.notify_all();
+}
+
+//Caller holds state_mtx through lock, which is released while the scheduler finishes its direct pass
+void SteamAudioServer::wait_for_direct_pass(std::unique_lock<std::mutex>& lock) {
+    direct_cv.wait(lock, [&]{ return !direct_processing; });
+}
 
+//Caller holds state_mtx, returns false if the previous reflection pass is still running
+bool SteamAudioServer::run_reflection_simulation() {
     if (indirect_thread_processing.load())
-        return;
+        return false;
 
-    //If we got here, outputs should be ready
+    //A new simulator is waiting to be swapped in, don't start a pass the swap would have to wait for
+    if (quality_swap_ready.load())
+        return false;
 
-    for (LocalStateSteamAudio * local_state : local_states) {
-        //Write outputs
-        if (local_state->sim_outputs.indirect_sim_started) {
-            SimOutputsSteamAudio * sim_outputs = &(local_state->sim_outputs);
-            int ind_wr_idx = get_write_indirect_idx(sim_outputs);
-            int ind_rd_idx = get_read_indirect_idx(sim_outputs);
-            iplSourceGetOutputs(local_state->source.src, IPL_SIMULATIONFLAGS_REFLECTIONS, &(sim_outputs->indirect_outputs[ind_wr_idx].indirect_sim_outputs));
-            sim_outputs->indirect_valid[ind_wr_idx].store(true);
-            bool read_indirect_valid = sim_outputs->indirect_valid[ind_rd_idx].load();
-            bool indirect_read_done = sim_outputs->indirect_read_done.load();
+    //If we got here, outputs should be ready
+    publish_reflection_outputs();
 
-            if (!read_indirect_valid || indirect_read_done) {
-                sim_outputs->indirect_idx.store(1-sim_outputs->indirect_idx.load());
-                sim_outputs->indirect_read_done.store(false);
-            }
-        }
+    if (cluster_radius > 0.0f) {
+        update_source_clusters();
+    }
 
-        local_state->sim_outputs.indirect_sim_started = true;
+    for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
+        SourceClusterSteamAudio * cluster = local_state->cluster;
+        bool shared = cluster && cluster->proxy && cluster->members.size() > 1;
+        //Clustered members skip their own reflection pass
+        local_state->sim_outputs.indirect_sim_started = !shared;
         IPLSimulationInputs inputs{};
-        inputs.flags = IPL_SIMULATIONFLAGS_REFLECTIONS;
+        inputs.flags = shared ? static_cast<IPLSimulationFlags>(0) : IPL_SIMULATIONFLAGS_REFLECTIONS;
         inputs.source = local_state->source_coordinates_cache;
+        set_reflection_inputs_steamaudio(global_state, inputs);
         iplSourceSetInputs(local_state->source.src, IPL_SIMULATIONFLAGS_REFLECTIONS, &inputs);
         
     }
 
+    for (SourceClusterSteamAudio * cluster : clusters) {
+        if (cluster->proxy == nullptr) {
+            continue;
+        }
+        bool shared = cluster->members.size() > 1;
+        cluster->proxy_ready = shared;
+        IPLSimulationInputs inputs{};
+        inputs.flags = shared ? IPL_SIMULATIONFLAGS_REFLECTIONS : static_cast<IPLSimulationFlags>(0);
+        inputs.source.ahead = IPLVector3{0.0f,0.0f,0.0f};
+        inputs.source.up = IPLVector3{0.0f,0.0f,0.0f};
+        inputs.source.right = IPLVector3{0.0f,0.0f,0.0f};
+        inputs.source.origin = GDVec3toIPLVec3(cluster->center);
+        set_reflection_inputs_steamaudio(global_state, inputs);
+        iplSourceSetInputs(cluster->proxy, IPL_SIMULATIONFLAGS_REFLECTIONS, &inputs);
+    }
+
+    IPLSimulationSharedInputs shared_inputs{};
+    shared_inputs.listener = published_listener;
     shared_inputs.numRays = global_state.sim_settings.maxNumRays;
-    shared_inputs.numBounces = 16; //need project settings for this, or pass in as part of tick args
+    shared_inputs.numBounces = global_state.num_bounces;
     shared_inputs.duration = global_state.sim_settings.maxDuration;
     shared_inputs.order = global_state.sim_settings.maxOrder;
     shared_inputs.irradianceMinDistance = 1.0f;
 
     iplSimulatorSetSharedInputs(global_state.simulator, IPL_SIMULATIONFLAGS_REFLECTIONS, &shared_inputs);
 
+    reflection_pose_usec = published_usec;
+    reflection_outputs_pending = true;
     {
         std::unique_lock<std::mutex> lock(mtx);
         indirect_thread_processing.store(true);
         cv.notify_one();
     }
 
-    return;
+    return true;
+}
+
+//Caller holds state_mtx and the last reflection pass has finished. Publishes its outputs once,
+//either from the next run_reflection_simulation() or straight after waiting on the pass
+void SteamAudioServer::publish_reflection_outputs() {
+    if (!reflection_outputs_pending) {
+        return;
+    }
+    reflection_outputs_pending = false;
+    uint64_t sim_usec = reflection_pose_usec;
+
+    for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
+        SourceClusterSteamAudio * cluster = local_state->cluster;
+        bool shared = cluster && cluster->proxy && cluster->members.size() > 1;
+        //Write outputs, from the cluster proxy once it has completed a pass
+        if (shared && cluster->proxy_ready) {
+            IndirectOutputsSteamAudio& indirect_outputs = local_state->sim_outputs.indirect.write_slot();
+            iplSourceGetOutputs(cluster->proxy, IPL_SIMULATIONFLAGS_REFLECTIONS, &(indirect_outputs.indirect_sim_outputs));
+            local_state->sim_outputs.indirect.publish(sim_usec);
+        } else if (local_state->sim_outputs.indirect_sim_started) {
+            IndirectOutputsSteamAudio& indirect_outputs = local_state->sim_outputs.indirect.write_slot();
+            iplSourceGetOutputs(local_state->source.src, IPL_SIMULATIONFLAGS_REFLECTIONS, &(indirect_outputs.indirect_sim_outputs));
+            local_state->sim_outputs.indirect.publish(sim_usec);
+        }
+    }
+}
+
+//Incremental: only sources that moved out of their cluster's radius are reassigned
+void SteamAudioServer::update_source_clusters() {
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO);
+    bool simulator_dirty = false;
+    float radius_sq = cluster_radius * cluster_radius;
+
+    for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
+        SourceClusterSteamAudio * cluster = local_state->cluster;
+        if (cluster && cluster->center.distance_squared_to(local_state->published_source_pos) > radius_sq) {
+            cluster->members.erase(local_state);
+            local_state->cluster = nullptr;
+        }
+    }
+
+    for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
+        if (local_state->cluster) {
+            continue;
+        }
+        Vector3 source_pos = local_state->published_source_pos;
+        for (SourceClusterSteamAudio * cluster : clusters) {
+            if (cluster->empty_passes == 0 && cluster->center.distance_squared_to(source_pos) <= radius_sq) {
+                local_state->cluster = cluster;
+                cluster->members.push_back(local_state);
+                break;
+            }
+        }
+        if (local_state->cluster) {
+            continue;
+        }
+
+        //The proxy waits until a second member joins, a lone source simulates itself
+        SourceClusterSteamAudio * cluster = memnew(SourceClusterSteamAudio);
+        cluster->center = source_pos;
+        cluster->members.push_back(local_state);
+        local_state->cluster = cluster;
+        clusters.push_back(cluster);
+    }
+
+    for (uint32_t cidx = 0; cidx < clusters.size();) {
+        SourceClusterSteamAudio * cluster = clusters[cidx];
+        if (!cluster->members.is_empty()) {
+            Vector3 center;
+            for (LocalStateSteamAudio * member : cluster->members) {
+                center += member->published_source_pos;
+            }
+            cluster->center = center / cluster->members.size();
+            cluster->empty_passes = 0;
+        }
+        if (cluster->members.size() > 1) {
+            cluster->proxy_idle_passes = 0;
+            if (cluster->proxy == nullptr) {
+                //Proxies come out of the same pool as player sources, without a free one the members keep their own passes
+                cluster->proxy = take_pool_source();
+                if (cluster->proxy) {
+                    cluster_proxies++;
+                    iplSourceAdd(cluster->proxy, global_state.simulator);
+                    simulator_dirty = true;
+                }
+            }
+        } else if (cluster->proxy) {
+            //Former members may still be mixing with the proxy's IR, keep it alive for a couple of passes
+            cluster->proxy_idle_passes++;
+            if (cluster->proxy_idle_passes >= 3) {
+                release_cluster_proxy(cluster);
+                simulator_dirty = true;
+            }
+        }
+        if (!cluster->members.is_empty()) {
+            cidx++;
+            continue;
+        }
+        cluster->empty_passes++;
+        if (cluster->proxy || cluster->empty_passes < 3) {
+            cidx++;
+            continue;
+        }
+        memdelete(cluster);
+        clusters.remove_at_unordered(cidx);
+        simulator_dirty = true;
+    }
+
+    if (simulator_dirty) {
+        iplSimulatorCommit(global_state.simulator);
+    }
+}
+
+//Caller holds state_mtx, the proxy goes back to the pool like a returned player source
+void SteamAudioServer::release_cluster_proxy(SourceClusterSteamAudio * cluster) {
+    iplSourceRemove(cluster->proxy, global_state.simulator);
+    IPLSimulationInputs inputs{};
+    iplSourceSetInputs(cluster->proxy, static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT|IPL_SIMULATIONFLAGS_REFLECTIONS), &inputs);
+    sources_pending_return.push_back(cluster->proxy);
+    cluster->proxy = nullptr;
+    cluster->proxy_ready = false;
+    cluster_proxies--;
+}
+
+void SteamAudioServer::release_source_clusters() {
+    for (SourceClusterSteamAudio * cluster : clusters) {
+        for (LocalStateSteamAudio * member : cluster->members) {
+            member->cluster = nullptr;
+        }
+        if (cluster->proxy) {
+            release_cluster_proxy(cluster);
+        }
+        memdelete(cluster);
+    }
+    clusters.clear();
+}
+
+//Runs direct and reflection simulation at their own fixed rates from the latest published poses.
+//When a deadline is missed the missed ticks are dropped rather than run back to back
+void SteamAudioServer::scheduler_worker(void *p_udata) {
+    SteamAudioServer* srv = (SteamAudioServer *)p_udata;
+    trace_thread_name_steamaudio("steamaudio_scheduler");
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO);
+    const std::chrono::microseconds direct_period((int64_t)(1000000.0f / srv->direct_rate));
+    const std::chrono::microseconds reflection_period((int64_t)(1000000.0f / MAX(srv->reflection_rate, 0.01f)));
+    std::chrono::steady_clock::time_point next_direct = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point next_reflection = next_direct;
+
+    std::unique_lock<std::mutex> lock(srv->state_mtx);
+    while (srv->running.load()) {
+        srv->scheduler_cv.wait_until(lock, MIN(next_direct, next_reflection), [&]{ return not srv->running.load(); });
+        if (srv->running.load()==false)
+            break;
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        //render_offline() simulates in lockstep with its own blocks and only drops state_mtx between them,
+        //apply_quality_swap() needs both simulators idle until it has the AudioServer lock
+        if (!srv->poses_published || srv->global_state.offline_render.load() || srv->quality_swap_in_progress) {
+            next_direct = now + direct_period;
+            next_reflection = now + reflection_period;
+            continue;
+        }
+
+        if (now >= next_direct) {
+            //Only the inputs and outputs are copied under the lock, tick() and the audio thread aren't held up by the pass
+            srv->prepare_direct_simulation();
+            lock.unlock();
+            {
+                TRACE_SCOPE_STEAMAUDIO("run_direct");
+                iplSimulatorRunDirect(srv->global_state.simulator);
+            }
+            lock.lock();
+            srv->publish_direct_simulation();
+            if (srv->running.load()==false)
+                break;
+            now = std::chrono::steady_clock::now();
+            next_direct += direct_period;
+            if (next_direct <= now) {
+                srv->direct_ticks_skipped += (now - next_direct) / direct_period + 1;
+                next_direct = now + direct_period;
+            }
+        }
+
+        if (now >= next_reflection) {
+            if (!srv->run_reflection_simulation()) {
+                //Previous pass still running, coalesce into the next slot
+                srv->reflection_ticks_skipped++;
+                next_reflection = now + reflection_period;
+            } else {
+                next_reflection += reflection_period;
+                if (next_reflection <= now) {
+                    srv->reflection_ticks_skipped += (now - next_reflection) / reflection_period + 1;
+                    next_reflection = now + reflection_period;
+                }
+            }
+        }
+    }
 }
 
 GlobalStateSteamAudio* SteamAudioServer::clone_global_state() {
@@ -170,33 +529,1104 @@ GlobalStateSteamAudio* SteamAudioServer::clone_global_state() {
     if (global_state_initialized.load()==false) {
         init_global_state_steamaudio(global_state);
         global_state_initialized.store(true);
+        prewarm_source_pool();
+        AudioServer::get_singleton()->add_mix_callback(SteamAudioServer::mix_block_started, this);
+        mix_callback_registered = true;
     }
     return &global_state;
 }
 
+//Runs on the audio thread before each mix step, numbers the blocks for record_mix_time_steamaudio()
+void SteamAudioServer::mix_block_started(void *p_udata) {
+    SteamAudioServer* srv = (SteamAudioServer *)p_udata;
+    srv->global_state.stats.mix_blocks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SteamAudioServer::prewarm_source_pool() {
+    int prewarm = MIN(source_pool_prewarm, global_state.sim_settings.maxNumSources);
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO);
+    std::unique_lock<std::mutex> lock(state_mtx);
+    while ((int)source_pool.size() < prewarm) {
+        IPLSource src = nullptr;
+        IPLSourceSettings source_settings{};
+        source_settings.flags = static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT|IPL_SIMULATIONFLAGS_REFLECTIONS);
+        IPLerror error_code = iplSourceCreate(global_state.simulator, &source_settings, &src);
+        if (error_code) {
+            printf("Err code for iplSourceCreate: %d\n", error_code);
+            return;
+        }
+        source_pool.push_back(src);
+    }
+}
+
+//Every source the simulator can see, player sources and cluster proxies alike
+int SteamAudioServer::get_num_pool_sources() const {
+    return sources_checked_out + cluster_proxies + source_pool.size() + sources_pending_return.size();
+}
+
+//Caller holds state_mtx and has committed the simulator since the sources were returned
+void SteamAudioServer::recycle_returned_sources() {
+    //Removals have now been applied, returned sources can be handed out again
+    for (IPLSource src : sources_pending_return) {
+        source_pool.push_back(src);
+    }
+    sources_pending_return.clear();
+}
+
+//Caller holds state_mtx. Pops a pooled source, creating one only while under sim_settings.maxNumSources
+IPLSource SteamAudioServer::take_pool_source() {
+    IPLSource src = nullptr;
+    //Don't let a burst of stops and plays between two ticks exhaust the pool, commit the removals now if nothing is simulating
+    if (source_pool.is_empty() && !sources_pending_return.is_empty() && !indirect_thread_processing.load() && !direct_processing) {
+        iplSimulatorCommit(global_state.simulator);
+        recycle_returned_sources();
+    }
+    if (!source_pool.is_empty()) {
+        src = source_pool[source_pool.size() - 1];
+        source_pool.resize(source_pool.size() - 1);
+        return src;
+    }
+    if (get_num_pool_sources() >= global_state.sim_settings.maxNumSources) {
+        return nullptr;
+    }
+    IPLSourceSettings source_settings{};
+    source_settings.flags = static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT|IPL_SIMULATIONFLAGS_REFLECTIONS);
+    IPLerror error_code = iplSourceCreate(global_state.simulator, &source_settings, &src);
+    if (error_code) {
+        printf("Err code for iplSourceCreate: %d\n", error_code);
+        return nullptr;
+    }
+    return src;
+}
+
+IPLSource SteamAudioServer::checkout_source() {
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO);
+    LockTimerSteamAudio lock_timer("state_mtx: SteamAudioServer::checkout_source");
+    std::unique_lock<std::mutex> lock(state_mtx);
+    lock_timer.acquired();
+    IPLSource src = take_pool_source();
+    if (src == nullptr) {
+        printf("Steam Audio source pool exhausted (%d sources)\n", get_num_pool_sources());
+        return nullptr;
+    }
+    sources_checked_out++;
+    return src;
+}
+
+//Caller holds state_mtx and has already removed src from the simulator
+void SteamAudioServer::return_source(IPLSource src) {
+    //Clear the inputs so nothing from the last owner carries over to the next
+    IPLSimulationInputs inputs{};
+    iplSourceSetInputs(src, static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT|IPL_SIMULATIONFLAGS_REFLECTIONS), &inputs);
+    sources_pending_return.push_back(src);
+    sources_checked_out--;
+}
+
+void SteamAudioServer::release_source_pool() {
+    for (IPLSource src : source_pool) {
+        iplSourceRelease(&src);
+    }
+    source_pool.clear();
+    for (IPLSource src : sources_pending_return) {
+        iplSourceRelease(&src);
+    }
+    sources_pending_return.clear();
+}
+
+void SteamAudioServer::register_playback(AudioStreamPlaybackSteamAudio * playback) {
+    LockTimerSteamAudio lock_timer("state_mtx: SteamAudioServer::register_playback");
+    std::unique_lock<std::mutex> lock(state_mtx);
+    lock_timer.acquired();
+    playbacks.push_back(playback);
+}
+
+void SteamAudioServer::deregister_playback(AudioStreamPlaybackSteamAudio * playback) {
+    LockTimerSteamAudio lock_timer("state_mtx: SteamAudioServer::deregister_playback");
+    std::unique_lock<std::mutex> lock(state_mtx);
+    lock_timer.acquired();
+    playbacks.erase(playback);
+}
+
+//Builds a simulator, sources and playback resources for the new settings on quality_thread, the next tick()
+//swaps them in. The scene, HRTF and context are kept. Returns ERR_BUSY while a previous change is in flight
+Error SteamAudioServer::set_settings(const Ref<SteamAudioSettings>& settings) {
+    ERR_FAIL_COND_V(settings.is_null(), ERR_INVALID_PARAMETER);
+    clone_global_state();
+    if (quality_swap_pending.load()) {
+        return ERR_BUSY;
+    }
+
+    quality_staging = memnew(GlobalStateSteamAudio);
+    quality_memory_ledger = memnew(MemoryLedgerSteamAudio);
+    quality_staging->phonon_ctx = global_state.phonon_ctx;
+    quality_staging->audio_settings = global_state.audio_settings;
+    quality_staging->hrtf = global_state.hrtf;
+    quality_staging->buffer_size = global_state.buffer_size;
+    quality_staging->sim_settings = global_state.sim_settings;
+    quality_staging->simulator = nullptr;
+    apply_quality_settings_steamaudio(*quality_staging, settings->get_quality());
+    {
+        std::unique_lock<std::mutex> lock(state_mtx);
+        quality_playbacks = playbacks;
+        quality_resources.resize(playbacks.size());
+        for (uint32_t pidx = 0; pidx < playbacks.size(); pidx++) {
+            quality_resources[pidx].reflection_type = playbacks[pidx]->get_reflection_type();
+            quality_resources[pidx].effects.resize(playbacks[pidx]->get_num_effects());
+        }
+        //Enough for every playing source plus the pool, as far as the new limit allows.
+        //Past the limit the swap takes the sources of the players farthest from the listener
+        int num_sources = get_num_pool_sources();
+        quality_num_sources = MIN(num_sources, quality_staging->sim_settings.maxNumSources);
+    }
+    quality_error_code = 0;
+    quality_swap_pending.store(true);
+    quality_thread.start(SteamAudioServer::quality_worker, this);
+    return OK;
+}
+
+Ref<SteamAudioSettings> SteamAudioServer::get_settings() {
+    Ref<SteamAudioSettings> settings;
+    settings.instantiate();
+    settings->set_quality(get_quality_settings_steamaudio(*clone_global_state()));
+    return settings;
+}
+
+void SteamAudioServer::quality_worker(void *p_udata) {
+    SteamAudioServer* srv = (SteamAudioServer *)p_udata;
+    trace_thread_name_steamaudio("steamaudio_quality");
+    GlobalStateSteamAudio& staging = *(srv->quality_staging);
+    MEMORY_LEDGER_STEAMAUDIO(*(srv->quality_memory_ledger));
+    int error_code = 0;
+    {
+        MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO);
+        error_code = iplSimulatorCreate(staging.phonon_ctx, &(staging.sim_settings), &(staging.simulator));
+        if (error_code) {
+            printf("Err code for iplSimulatorCreate: %d\n", error_code);
+        }
+        for (int sidx = 0; sidx < srv->quality_num_sources && error_code == 0; sidx++) {
+            IPLSource src = nullptr;
+            IPLSourceSettings source_settings{};
+            source_settings.flags = static_cast<IPLSimulationFlags>(IPL_SIMULATIONFLAGS_DIRECT|IPL_SIMULATIONFLAGS_REFLECTIONS);
+            error_code = iplSourceCreate(staging.simulator, &source_settings, &src);
+            if (error_code) {
+                printf("Err code for iplSourceCreate: %d\n", error_code);
+                break;
+            }
+            srv->quality_sources.push_back(src);
+        }
+    }
+    for (uint32_t ridx = 0; ridx < srv->quality_resources.size() && error_code == 0; ridx++) {
+        error_code = init_quality_resources_steamaudio(staging, srv->quality_resources[ridx]);
+    }
+    srv->quality_error_code = error_code;
+    srv->quality_swap_ready.store(true);
+}
+
+struct SourceDistanceSteamAudio {
+    float distance_sq;
+    LocalStateSteamAudio * local_state;
+    bool operator<(const SourceDistanceSteamAudio& other) const {
+        return distance_sq < other.distance_sq;
+    }
+};
+
+//Called from tick(). Sources keep their direct results across the swap, reflections restart on the new simulator.
+//Everything is built before the locks are taken, under them only sources and resources change hands
+void SteamAudioServer::apply_quality_swap() {
+    quality_thread.wait_to_finish();
+    if (quality_error_code) {
+        printf("Err code for set_settings: %d\n", quality_error_code);
+        release_quality_staging();
+        return;
+    }
+
+    //Playbacks that appeared or changed since set_settings() get their resources now, before any lock is taken.
+    //Playbacks are only created and destroyed on this thread, so the list can't change until the swap
+    LocalVector<AudioStreamPlaybackSteamAudio*> swap_playbacks;
+    {
+        std::unique_lock<std::mutex> lock(state_mtx);
+        swap_playbacks = playbacks;
+    }
+    {
+        MEMORY_LEDGER_STEAMAUDIO(*quality_memory_ledger);
+        for (AudioStreamPlaybackSteamAudio * playback : swap_playbacks) {
+            int64_t pidx = quality_playbacks.find(playback);
+            if (pidx >= 0 && (int)quality_resources[pidx].effects.size() == playback->get_num_effects() && quality_resources[pidx].reflection_type == playback->get_reflection_type()) {
+                continue;
+            }
+            QualityResourcesSteamAudio resources;
+            resources.reflection_type = playback->get_reflection_type();
+            resources.effects.resize(playback->get_num_effects());
+            int error_code = init_quality_resources_steamaudio(*quality_staging, resources);
+            if (error_code) {
+                //A playback left with buffers and effects of the old order would be mixed with the new one, so nothing is swapped
+                printf("Err code for init_quality_resources_steamaudio: %d\n", error_code);
+                deinit_quality_resources_steamaudio(*quality_staging, resources);
+                release_quality_staging();
+                return;
+            }
+            if (pidx >= 0) {
+                deinit_quality_resources_steamaudio(*quality_staging, quality_resources[pidx]);
+                quality_resources[pidx] = resources;
+            } else {
+                quality_playbacks.push_back(playback);
+                quality_resources.push_back(resources);
+            }
+        }
+    }
+
+    //Keep the scheduler from starting passes and let the running ones finish before the audio thread is locked out.
+    //tick() runs on this thread, so nothing else starts a pass until the flag is cleared
+    {
+        LockTimerSteamAudio lock_timer("state_mtx: SteamAudioServer::apply_quality_swap");
+        std::unique_lock<std::mutex> lock(state_mtx);
+        lock_timer.acquired();
+        quality_swap_in_progress = true;
+        wait_for_direct_pass(lock);
+    }
+    wait_for_reflection_pass();
+
+    IPLSimulator old_simulator = global_state.simulator;
+    LocalVector<IPLSource> old_sources;
+    LockTimerSteamAudio audio_lock_timer("AudioServer: SteamAudioServer::apply_quality_swap");
+    AudioServer::get_singleton()->lock();
+    audio_lock_timer.acquired();
+    {
+        LockTimerSteamAudio lock_timer("state_mtx: SteamAudioServer::apply_quality_swap");
+        std::unique_lock<std::mutex> lock(state_mtx);
+        lock_timer.acquired();
+        MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO);
+        release_source_clusters();
+
+        global_state.simulator = quality_staging->simulator;
+        global_state.sim_settings = quality_staging->sim_settings;
+        global_state.num_bounces = quality_staging->num_bounces;
+        quality_staging->simulator = nullptr;
+        iplSimulatorSetScene(global_state.simulator, global_state.scene);
+
+        Vector3 listener_pos = IPLVec3toGDVec3(published_listener.origin);
+        LocalVector<SourceDistanceSteamAudio> by_distance;
+        for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
+            iplSourceRemove(local_state->source.src, old_simulator);
+            old_sources.push_back(local_state->source.src);
+            local_state->source.src = nullptr;
+            by_distance.push_back(SourceDistanceSteamAudio{local_state->published_source_pos.distance_squared_to(listener_pos), local_state});
+        }
+        by_distance.sort();
+
+        //Only staged sources are handed out, nothing is created under the lock. When the new tier allows fewer
+        //sources than are playing, or players started since set_settings(), the farthest players go without
+        LocalVector<LocalStateSteamAudio*> orphaned;
+        for (const SourceDistanceSteamAudio& entry : by_distance) {
+            LocalStateSteamAudio * local_state = entry.local_state;
+            if (quality_sources.is_empty()) {
+                orphaned.push_back(local_state);
+                continue;
+            }
+            local_state->source.src = quality_sources[quality_sources.size() - 1];
+            quality_sources.resize(quality_sources.size() - 1);
+            iplSourceAdd(local_state->source.src, global_state.simulator);
+            //The old IRs are about to be released
+            local_state->sim_outputs.indirect.reset();
+            local_state->sim_outputs.indirect_sim_started = false;
+        }
+        //Without a source the player goes silent until it is played again
+        for (LocalStateSteamAudio * local_state : orphaned) {
+            source_index.remove(local_state->source_index_handle);
+            local_state->source_index_handle = SOURCE_INDEX_INVALID_HANDLE_STEAMAUDIO;
+            local_state->source.source_initialized = false;
+            sources_checked_out--;
+        }
+
+        for (IPLSource src : source_pool) {
+            old_sources.push_back(src);
+        }
+        for (IPLSource src : sources_pending_return) {
+            old_sources.push_back(src);
+        }
+        source_pool = quality_sources;
+        sources_pending_return.clear();
+        quality_sources.clear();
+        iplSimulatorCommit(global_state.simulator);
+
+        //Each playback swaps in its staged resources, whatever is swapped out is left in quality_resources
+        //and freed with the staging once the lock is released
+        for (AudioStreamPlaybackSteamAudio * playback : playbacks) {
+            int64_t pidx = quality_playbacks.find(playback);
+            if (pidx >= 0) {
+                playback->swap_quality_resources(quality_resources[pidx]);
+            }
+        }
+        quality_swap_in_progress = false;
+    }
+    AudioServer::get_singleton()->unlock();
+
+    for (IPLSource src : old_sources) {
+        iplSourceRelease(&src);
+    }
+    iplSimulatorRelease(&old_simulator);
+    release_quality_staging();
+    emit_signal(SNAME("settings_applied"));
+}
+
+//Frees whatever the last set_settings() built or swapped out
+void SteamAudioServer::release_quality_staging() {
+    for (QualityResourcesSteamAudio& resources : quality_resources) {
+        deinit_quality_resources_steamaudio(global_state, resources);
+    }
+    quality_resources.clear();
+    quality_playbacks.clear();
+    for (IPLSource src : quality_sources) {
+        iplSourceRelease(&src);
+    }
+    quality_sources.clear();
+    if (quality_staging->simulator) {
+        iplSimulatorRelease(&(quality_staging->simulator));
+    }
+    memdelete(quality_staging);
+    quality_staging = nullptr;
+    //What's left on the staged ledger is now part of the live server
+    merge_memory_ledger_steamaudio(quality_memory_ledger, get_live_memory_ledger_steamaudio());
+    quality_memory_ledger = nullptr;
+    quality_swap_ready.store(false);
+    quality_swap_pending.store(false);
+}
+
+static const char * monitor_names_steamaudio[] = {
+    "SteamAudio/tick_ms",
+    "SteamAudio/direct_sim_ms",
+    "SteamAudio/reflections_ms",
+    "SteamAudio/reflections_per_second",
+    "SteamAudio/sources_active",
+    "SteamAudio/sources_virtual",
+    "SteamAudio/sources_registered",
+    "SteamAudio/spatialize_min_ms",
+    "SteamAudio/spatialize_avg_ms",
+    "SteamAudio/spatialize_p99_ms",
+    "SteamAudio/effect_memory_kib",
+    "SteamAudio/buffer_memory_kib",
+    "SteamAudio/hrtf_memory_kib",
+    "SteamAudio/scene_memory_kib",
+    "SteamAudio/simulator_memory_kib",
+    "SteamAudio/total_memory_kib",
+    "SteamAudio/direct_stale_reads",
+    "SteamAudio/reflection_stale_reads",
+    "SteamAudio/mix_max_ms",
+    "SteamAudio/mix_overruns",
+    "SteamAudio/realtime_violations",
+    "SteamAudio/lock_wait_max_ms",
+    "SteamAudio/lock_hold_max_ms",
+};
+
+void SteamAudioServer::register_monitors() {
+    Performance * performance = Performance::get_singleton();
+    for (int monitor = 0; monitor < MONITOR_MAX; monitor++) {
+        Vector<Variant> args;
+        args.push_back(monitor);
+        if (!performance->has_custom_monitor(monitor_names_steamaudio[monitor])) {
+            performance->add_custom_monitor(monitor_names_steamaudio[monitor], callable_mp(this, &SteamAudioServer::get_monitor_value), args);
+        }
+    }
+    //The first window starts now, not at boot
+    monitor_window_start_usec = ticks_usec_steamaudio();
+    monitor_reflection_runs = global_state.stats.reflection_runs.load();
+    monitors_registered = true;
+}
+
+//The callables point at this server, they can't outlive it
+void SteamAudioServer::unregister_monitors() {
+    Performance * performance = Performance::get_singleton();
+    if (!monitors_registered || performance == nullptr) {
+        return;
+    }
+    for (int monitor = 0; monitor < MONITOR_MAX; monitor++) {
+        if (performance->has_custom_monitor(monitor_names_steamaudio[monitor])) {
+            performance->remove_custom_monitor(monitor_names_steamaudio[monitor]);
+        }
+    }
+    monitors_registered = false;
+}
+
+//Caller holds state_mtx. Windowed values are recomputed once per window so min/avg/p99 stay readable in the debugger
+void SteamAudioServer::update_monitor_window(uint64_t now_usec) {
+    StatsSteamAudio& stats = global_state.stats;
+    double window_sec = monitor_window_start_usec ? (now_usec - monitor_window_start_usec) / 1000000.0 : 0.0;
+
+    uint64_t reflection_runs = stats.reflection_runs.load();
+    monitor_values[MONITOR_REFLECTIONS_PER_SEC] = window_sec > 0.0 ? (reflection_runs - monitor_reflection_runs) / window_sec : 0.0;
+    monitor_reflection_runs = reflection_runs;
+
+    uint32_t histogram[SPATIALIZE_HISTOGRAM_BUCKETS_STEAMAUDIO];
+    uint64_t num_blocks = 0;
+    for (int bucket = 0; bucket < SPATIALIZE_HISTOGRAM_BUCKETS_STEAMAUDIO; bucket++) {
+        histogram[bucket] = stats.spatialize_histogram[bucket].exchange(0);
+        num_blocks += histogram[bucket];
+    }
+    uint64_t sum_usec = stats.spatialize_sum_usec.exchange(0);
+    uint64_t min_usec = stats.spatialize_min_usec.exchange(UINT64_MAX);
+    if (num_blocks > 0) {
+        //p99 is the upper edge of the bucket holding the 99th percentile block
+        uint64_t p99_rank = (num_blocks * 99 + 99) / 100;
+        uint64_t seen = 0;
+        int p99_bucket = SPATIALIZE_HISTOGRAM_BUCKETS_STEAMAUDIO - 1;
+        for (int bucket = 0; bucket < SPATIALIZE_HISTOGRAM_BUCKETS_STEAMAUDIO; bucket++) {
+            seen += histogram[bucket];
+            if (seen >= p99_rank) {
+                p99_bucket = bucket;
+                break;
+            }
+        }
+        monitor_values[MONITOR_SPATIALIZE_MIN_MSEC] = min_usec / 1000.0;
+        monitor_values[MONITOR_SPATIALIZE_AVG_MSEC] = sum_usec / 1000.0 / num_blocks;
+        monitor_values[MONITOR_SPATIALIZE_P99_MSEC] = (p99_bucket + 1) * SPATIALIZE_HISTOGRAM_BUCKET_USEC_STEAMAUDIO / 1000.0;
+    } else {
+        monitor_values[MONITOR_SPATIALIZE_MIN_MSEC] = 0.0;
+        monitor_values[MONITOR_SPATIALIZE_AVG_MSEC] = 0.0;
+        monitor_values[MONITOR_SPATIALIZE_P99_MSEC] = 0.0;
+    }
+
+    //Registered sources that weren't spatialized this window are simulated but not heard
+    int sources_active = 0;
+    uint64_t direct_stale = 0, indirect_stale = 0;
+    const LocalVector<LocalStateSteamAudio*>& sources = source_index.get_sources();
+    for (LocalStateSteamAudio * local_state : sources) {
+        if (local_state->last_spatialize_usec.load(std::memory_order_relaxed) >= monitor_window_start_usec) {
+            sources_active++;
+        }
+        direct_stale += local_state->sim_outputs.direct.get_stale_count();
+        indirect_stale += local_state->sim_outputs.indirect.get_stale_count();
+    }
+    monitor_values[MONITOR_SOURCES_ACTIVE] = sources_active;
+    monitor_values[MONITOR_SOURCES_VIRTUAL] = (int)sources.size() - sources_active;
+    monitor_values[MONITOR_SOURCES_REGISTERED] = sources.size();
+    monitor_values[MONITOR_DIRECT_STALE_READS] = direct_stale;
+    monitor_values[MONITOR_REFLECTION_STALE_READS] = indirect_stale;
+    monitor_values[MONITOR_MIX_MAX_MSEC] = stats.mix_max_usec.exchange(0) / 1000.0;
+
+    //Prints any site that was hit for the first time this window
+    const char * sites[MAX_REALTIME_SITES_STEAMAUDIO];
+    uint64_t counts[MAX_REALTIME_SITES_STEAMAUDIO];
+    get_realtime_sites_steamaudio(sites, counts, MAX_REALTIME_SITES_STEAMAUDIO);
+
+    uint64_t lock_wait_usec = 0, lock_hold_usec = 0;
+    take_lock_window_steamaudio(lock_wait_usec, lock_hold_usec);
+    monitor_values[MONITOR_LOCK_WAIT_MAX_MSEC] = lock_wait_usec / 1000.0;
+    monitor_values[MONITOR_LOCK_HOLD_MAX_MSEC] = lock_hold_usec / 1000.0;
+
+    monitor_window_start_usec = now_usec;
+}
+
+double SteamAudioServer::get_monitor_value(int monitor) {
+    StatsSteamAudio& stats = global_state.stats;
+    switch (monitor) {
+        case MONITOR_TICK_MSEC:
+            return stats.tick_usec.load() / 1000.0;
+        case MONITOR_DIRECT_MSEC:
+            return stats.direct_usec.load() / 1000.0;
+        case MONITOR_REFLECTIONS_MSEC:
+            return stats.reflections_usec.load() / 1000.0;
+        case MONITOR_EFFECT_MEMORY_KIB:
+            return get_memory_bytes_steamaudio(get_live_memory_ledger_steamaudio(), MEMORY_CATEGORY_EFFECTS_STEAMAUDIO) / 1024.0;
+        case MONITOR_BUFFER_MEMORY_KIB:
+            return get_memory_bytes_steamaudio(get_live_memory_ledger_steamaudio(), MEMORY_CATEGORY_SOURCE_BUFFERS_STEAMAUDIO) / 1024.0;
+        case MONITOR_HRTF_MEMORY_KIB:
+            return get_memory_bytes_steamaudio(get_live_memory_ledger_steamaudio(), MEMORY_CATEGORY_HRTF_STEAMAUDIO) / 1024.0;
+        case MONITOR_SCENE_MEMORY_KIB:
+            return get_memory_bytes_steamaudio(get_live_memory_ledger_steamaudio(), MEMORY_CATEGORY_SCENE_STEAMAUDIO) / 1024.0;
+        case MONITOR_SIMULATOR_MEMORY_KIB:
+            return get_memory_bytes_steamaudio(get_live_memory_ledger_steamaudio(), MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO) / 1024.0;
+        case MONITOR_TOTAL_MEMORY_KIB:
+            return get_total_memory_bytes_steamaudio(get_live_memory_ledger_steamaudio()) / 1024.0;
+        case MONITOR_MIX_OVERRUNS:
+            return stats.mix_overruns.load();
+        case MONITOR_REALTIME_VIOLATIONS:
+            return get_realtime_violations_steamaudio();
+        default:
+            break;
+    }
+    ERR_FAIL_INDEX_V(monitor, MONITOR_MAX, 0.0);
+    return monitor_values[monitor];
+}
+
+Dictionary SteamAudioServer::get_geometry_stats() {
+    Dictionary stats;
+    stats["triangles_before"] = global_state.geometry_triangles_in.load();
+    stats["triangles_after"] = global_state.geometry_triangles_out.load();
+    return stats;
+}
+
+Dictionary SteamAudioServer::get_simulation_stats() {
+    Dictionary stats;
+    stats["direct_ticks_skipped"] = direct_ticks_skipped.load();
+    stats["reflection_ticks_skipped"] = reflection_ticks_skipped.load();
+
+    //Summed over the sources that are currently playing
+    uint64_t direct_dropped = 0, direct_stale = 0, indirect_dropped = 0, indirect_stale = 0;
+    {
+        std::unique_lock<std::mutex> lock(state_mtx);
+        for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
+            direct_dropped += local_state->sim_outputs.direct.get_dropped_count();
+            direct_stale += local_state->sim_outputs.direct.get_stale_count();
+            indirect_dropped += local_state->sim_outputs.indirect.get_dropped_count();
+            indirect_stale += local_state->sim_outputs.indirect.get_stale_count();
+        }
+        stats["source_clusters"] = (int)clusters.size();
+        stats["cluster_proxies"] = cluster_proxies;
+        stats["sources_checked_out"] = sources_checked_out;
+        stats["sources_pooled"] = (int)(source_pool.size() + sources_pending_return.size());
+    }
+    stats["direct_results_dropped"] = direct_dropped;
+    stats["direct_stale_reads"] = direct_stale;
+    stats["reflection_results_dropped"] = indirect_dropped;
+    stats["reflection_stale_reads"] = indirect_stale;
+    stats["mix_overruns"] = global_state.stats.mix_overruns.load();
+
+    //Allocations Steam Audio made on the audio thread, only populated in debug builds
+    Dictionary realtime_violations;
+    const char * sites[MAX_REALTIME_SITES_STEAMAUDIO];
+    uint64_t counts[MAX_REALTIME_SITES_STEAMAUDIO];
+    int num_sites = get_realtime_sites_steamaudio(sites, counts, MAX_REALTIME_SITES_STEAMAUDIO);
+    for (int site = 0; site < num_sites; site++) {
+        realtime_violations[String(sites[site])] = counts[site];
+    }
+    stats["realtime_violations"] = realtime_violations;
+
+    //Per site taking state_mtx or the AudioServer lock off the simulation threads, times since startup
+    Dictionary locks;
+    const char * lock_sites[MAX_LOCK_SITES_STEAMAUDIO];
+    LockStatsSteamAudio lock_stats[MAX_LOCK_SITES_STEAMAUDIO];
+    int num_lock_sites = get_lock_sites_steamaudio(lock_sites, lock_stats, MAX_LOCK_SITES_STEAMAUDIO);
+    for (int site = 0; site < num_lock_sites; site++) {
+        const LockStatsSteamAudio& lock_stat = lock_stats[site];
+        Dictionary site_stats;
+        site_stats["acquisitions"] = lock_stat.acquisitions;
+        site_stats["wait_avg_usec"] = lock_stat.acquisitions ? (double)lock_stat.wait_usec / lock_stat.acquisitions : 0.0;
+        site_stats["wait_max_usec"] = lock_stat.max_wait_usec;
+        site_stats["hold_avg_usec"] = lock_stat.acquisitions ? (double)lock_stat.hold_usec / lock_stat.acquisitions : 0.0;
+        site_stats["hold_max_usec"] = lock_stat.max_hold_usec;
+        locks[String(lock_sites[site])] = site_stats;
+    }
+    stats["locks"] = locks;
+    return stats;
+}
+
+//Bytes the live server currently holds in Steam Audio per category, plus the module's own work buffers under
+//source_buffers. Steam Audio's own worker threads are charged to simulator. Raytracer benchmarks and capture
+//replays aren't included, a staged quality change is once it has been swapped in
+Dictionary SteamAudioServer::get_memory_usage() {
+    Dictionary usage;
+    const MemoryLedgerSteamAudio& ledger = get_live_memory_ledger_steamaudio();
+    for (int category = 0; category < MEMORY_CATEGORY_MAX_STEAMAUDIO; category++) {
+        MemoryCategorySteamAudio memory_category = (MemoryCategorySteamAudio)category;
+        usage[get_memory_category_name_steamaudio(memory_category)] = get_memory_bytes_steamaudio(ledger, memory_category);
+    }
+    usage["total"] = get_total_memory_bytes_steamaudio(ledger);
+    usage["peak"] = get_peak_memory_bytes_steamaudio(ledger);
+    return usage;
+}
+
+//Positions are the ones published by the last tick()
+Array SteamAudioServer::get_sources_in_radius(const Vector3& center, float radius) {
+    Array players;
+    LocalVector<LocalStateSteamAudio*> found;
+    std::unique_lock<std::mutex> lock(state_mtx);
+    source_index.query_radius(center, radius, found);
+    for (LocalStateSteamAudio * local_state : found) {
+        players.push_back(local_state->source.steamaudio_player);
+    }
+    return players;
+}
+
+//Nearest first
+Array SteamAudioServer::get_nearest_sources(const Vector3& center, int count) {
+    Array players;
+    LocalVector<LocalStateSteamAudio*> found;
+    std::unique_lock<std::mutex> lock(state_mtx);
+    source_index.query_nearest(center, count, found);
+    for (LocalStateSteamAudio * local_state : found) {
+        players.push_back(local_state->source.steamaudio_player);
+    }
+    return players;
+}
+
+//Caller holds state_mtx
+void SteamAudioServer::wait_for_reflection_pass() {
+    while (indirect_thread_processing.load()) {
+        OS::get_singleton()->delay_usec(50);
+    }
+}
+
+//Renders duration seconds of every playing source to a 16-bit stereo WAV as fast as the CPU allows.
+//Blocks advance a virtual clock and simulation runs in lockstep with them, a direct pass every block and
+//a reflection pass every 1/reflection_rate seconds whose outputs are published before that block mixes,
+//so the output is deterministic. The AudioServer lock is taken per block; in between, the driver gets
+//silence from these players instead of advancing them.
+//Sources are mixed straight from their playbacks at the player volume, buses and effects are not applied
+Dictionary SteamAudioServer::render_offline(const String& path, float duration) {
+    Dictionary result;
+    ERR_FAIL_COND_V(!global_state_initialized.load() || listener == nullptr, result);
+    ERR_FAIL_COND_V(duration <= 0.0f, result);
+
+    //Applies pending geometry and publishes the poses the render starts from
+    tick();
+
+    int block_frames = global_state.buffer_size;
+    int mix_rate = global_state.audio_settings.samplingRate;
+    int num_blocks = (int)ceilf(duration * mix_rate / block_frames);
+    double block_usec = block_frames * 1000000.0 / mix_rate;
+    int reflection_interval = MAX(1, (int)roundf(mix_rate / (block_frames * MAX(reflection_rate, 0.01f))));
+
+    Vector<uint8_t> pcm;
+    pcm.resize(num_blocks * block_frames * 4);
+    uint8_t * pcm_ptr = pcm.ptrw();
+    LocalVector<AudioFrame> block;
+    block.resize(block_frames);
+    LocalVector<AudioFrame> mixed;
+    mixed.resize(block_frames);
+
+    uint64_t wall_start_usec = ticks_usec_steamaudio();
+    bool pose_extrapolation = false;
+    uint64_t virtual_start_usec = 0;
+    {
+        std::unique_lock<std::mutex> lock(state_mtx);
+        wait_for_direct_pass(lock);
+        wait_for_reflection_pass();
+        //Keeps the scheduler out between blocks and has the driver mix silence for these players until we're done
+        global_state.offline_render.store(true);
+        //Poses don't move during the render, extrapolating from the live pose history would only add drift
+        pose_extrapolation = global_state.pose_extrapolation.load();
+        global_state.pose_extrapolation.store(false);
+        virtual_start_usec = published_usec;
+    }
+
+    for (int bidx = 0; bidx < num_blocks; bidx++) {
+        {
+            std::unique_lock<std::mutex> lock(state_mtx);
+            published_usec = virtual_start_usec + (uint64_t)(bidx * block_usec);
+            run_direct_simulation();
+            if (bidx % reflection_interval == 0) {
+                run_reflection_simulation();
+                wait_for_reflection_pass();
+                //Collected now rather than by the next pass, so this block already mixes with them
+                publish_reflection_outputs();
+            }
+        }
+
+        //Only held while this block mixes, so the driver isn't stalled for the whole render
+        LockTimerSteamAudio audio_lock_timer("AudioServer: SteamAudioServer::render_offline");
+        AudioServer::get_singleton()->lock();
+        audio_lock_timer.acquired();
+        {
+            std::unique_lock<std::mutex> lock(state_mtx);
+            global_state.stats.mix_blocks.fetch_add(1, std::memory_order_relaxed);
+            memset(mixed.ptr(), 0, sizeof(AudioFrame) * block_frames);
+            for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
+                if (local_state->source.playback == nullptr) {
+                    continue;
+                }
+                memset(block.ptr(), 0, sizeof(AudioFrame) * block_frames);
+                local_state->source.playback->mix_sources(block.ptr(), 1.0f, block_frames);
+                float volume = Math::db_to_linear(local_state->source.steamaudio_player->get_volume_db());
+                for (int frame = 0; frame < block_frames; frame++) {
+                    mixed[frame] += volume * block[frame];
+                }
+            }
+        }
+        AudioServer::get_singleton()->unlock();
+
+        uint8_t * out = pcm_ptr + bidx * block_frames * 4;
+        for (int frame = 0; frame < block_frames; frame++) {
+            int16_t left = (int16_t)CLAMP(mixed[frame].l * 32767.0f, -32768.0f, 32767.0f);
+            int16_t right = (int16_t)CLAMP(mixed[frame].r * 32767.0f, -32768.0f, 32767.0f);
+            out[frame * 4 + 0] = (uint8_t)(left & 0xFF);
+            out[frame * 4 + 1] = (uint8_t)((left >> 8) & 0xFF);
+            out[frame * 4 + 2] = (uint8_t)(right & 0xFF);
+            out[frame * 4 + 3] = (uint8_t)((right >> 8) & 0xFF);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(state_mtx);
+        global_state.pose_extrapolation.store(pose_extrapolation);
+        global_state.offline_render.store(false);
+    }
+    uint64_t wall_usec = MAX(ticks_usec_steamaudio() - wall_start_usec, (uint64_t)1);
+
+    Ref<AudioStreamWAV> wav;
+    wav.instantiate();
+    wav->set_format(AudioStreamWAV::FORMAT_16_BITS);
+    wav->set_stereo(true);
+    wav->set_mix_rate(mix_rate);
+    wav->set_data(pcm);
+    Error error_code = wav->save_to_wav(path);
+    if (error_code) {
+        printf("Err code for save_to_wav: %d\n", error_code);
+        return result;
+    }
+
+    double audio_seconds = (double)num_blocks * block_frames / mix_rate;
+    result["blocks"] = num_blocks;
+    result["audio_seconds"] = audio_seconds;
+    result["wall_seconds"] = wall_usec / 1000000.0;
+    //Seconds of audio rendered per second of wall time
+    result["realtime_factor"] = audio_seconds * 1000000.0 / wall_usec;
+    return result;
+}
+
+//Spans from the main, audio and simulation threads are written to path as Chrome trace JSON on stop_trace()
+Error SteamAudioServer::start_trace(const String& path) {
+    return start_trace_steamaudio(path);
+}
+
+Error SteamAudioServer::stop_trace() {
+    return stop_trace_steamaudio();
+}
+
+//Records the scene once, then the listener pose and every source on each tick, for replay_capture()
+Error SteamAudioServer::start_capture(const String& path) {
+    std::unique_lock<std::mutex> lock(state_mtx);
+    if (capture_file.is_valid()) {
+        return ERR_ALREADY_IN_USE;
+    }
+    CaptureSettingsSteamAudio settings;
+    settings.direct_rate = direct_rate;
+    settings.reflection_rate = reflection_rate;
+    return begin_capture_steamaudio(global_state, settings, path, capture_file);
+}
+
+Error SteamAudioServer::stop_capture() {
+    std::unique_lock<std::mutex> lock(state_mtx);
+    if (capture_file.is_null()) {
+        return ERR_DOES_NOT_EXIST;
+    }
+    end_capture_steamaudio(capture_file);
+    return OK;
+}
+
+//Caller holds state_mtx
+void SteamAudioServer::capture_tick() {
+    LocalVector<CaptureSourceSteamAudio> sources;
+    for (LocalStateSteamAudio * local_state : source_index.get_sources()) {
+        CaptureSourceSteamAudio source;
+        source.id = (uint64_t)local_state->source.steamaudio_player->get_instance_id();
+        source.position = local_state->published_source_pos;
+        source.occlusion_radius = local_state->setting_occlusion_radius;
+        source.occlusion_num_samples = local_state->setting_occlusion_num_samples;
+        source.reflection_type = local_state->reflection_type;
+        sources.push_back(source);
+    }
+    capture_tick_steamaudio(capture_file, published_usec, published_listener, sources);
+}
+
+//Replays on a private simulator, so it is safe to call while simulation is running
+Dictionary SteamAudioServer::replay_capture(const String& path, const String& wav_path) {
+    Dictionary result;
+    int error_code = replay_capture_steamaudio(path, wav_path, result);
+    if (error_code) {
+        printf("Err code for replay_capture: %d\n", error_code);
+    }
+    return result;
+}
+
+//Runs on private scenes and simulators, so it is safe to call while simulation is running
+Dictionary SteamAudioServer::benchmark_raytracers(int subdivisions, int iterations) {
+    Dictionary results;
+    GlobalStateSteamAudio * gs = clone_global_state();
+    //The benchmark scenes and simulators are its own, keep them out of the server's memory numbers
+    MEMORY_LEDGER_STEAMAUDIO(get_private_memory_ledger_steamaudio());
+    Dictionary default_result;
+    if (benchmark_raytracer_steamaudio(*gs, IPL_SCENETYPE_DEFAULT, subdivisions, iterations, default_result) == 0) {
+        results["Default"] = default_result;
+    }
+    Dictionary embree_result;
+    if (benchmark_raytracer_steamaudio(*gs, IPL_SCENETYPE_EMBREE, subdivisions, iterations, embree_result) == 0) {
+        results["Embree"] = embree_result;
+    }
+    return results;
+}
+
+//Keeps the calling thread off the first reserved_cores cores, where the main and audio threads usually land
+static void pin_thread_steamaudio(int reserved_cores) {
+#ifdef __linux__
+    int num_cores = OS::get_singleton()->get_processor_count();
+    if (reserved_cores <= 0 || reserved_cores >= num_cores) {
+        return;
+    }
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int core = reserved_cores; core < num_cores; core++) {
+        CPU_SET(core, &cpu_set);
+    }
+    int error_code = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+    if (error_code) {
+        printf("Err code for pthread_setaffinity_np: %d\n", error_code);
+    }
+#endif
+}
+
+//Thread::Settings::priority is only applied on Windows, on Linux each thread has its own nice value.
+//Raising it needs CAP_SYS_NICE or a matching RLIMIT_NICE, without either High stays at Normal
+static void set_thread_priority_steamaudio(Thread::Priority priority) {
+#ifdef __linux__
+    int nice_value = 0;
+    if (priority == Thread::PRIORITY_LOW) {
+        nice_value = 10;
+    } else if (priority == Thread::PRIORITY_HIGH) {
+        nice_value = -5;
+    }
+    if (nice_value == 0) {
+        return;
+    }
+    if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice_value) != 0) {
+        printf("Err code for setpriority: %d\n", errno);
+    }
+#endif
+}
+
 void SteamAudioServer::indirect_worker(void *p_udata) {
     SteamAudioServer* srv = (SteamAudioServer *)p_udata;
+    trace_thread_name_steamaudio("steamaudio_indirect");
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SIMULATOR_STEAMAUDIO);
+    set_thread_priority_steamaudio(srv->indirect_thread_priority);
+    if (srv->pin_indirect_thread) {
+        pin_thread_steamaudio(srv->reserved_cores);
+    }
     while (srv->running.load()) {
         {
             std::unique_lock<std::mutex> lock(srv->mtx);
             srv->cv.wait(lock, [&]{ return srv->indirect_thread_processing.load() or not srv->running.load(); });
             if (srv->running.load()==false)
                 continue;
+            uint64_t start_usec = ticks_usec_steamaudio();
             iplSimulatorRunReflections(srv->global_state.simulator);
+            uint64_t end_usec = ticks_usec_steamaudio();
+            srv->global_state.stats.reflections_usec.store(end_usec - start_usec);
+            if (trace_enabled_steamaudio.load(std::memory_order_relaxed)) {
+                record_trace_event_steamaudio("run_reflections", start_usec, end_usec);
+            }
+            srv->global_state.stats.reflection_runs++;
             srv->indirect_thread_processing.store(false);
         }
     }
 }
 
+void SteamAudioServer::geometry_worker(void *p_udata) {
+    SteamAudioServer* srv = (SteamAudioServer *)p_udata;
+    trace_thread_name_steamaudio("steamaudio_geometry");
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SCENE_STEAMAUDIO);
+    while (srv->running.load()) {
+        GeometryJobSteamAudio * job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(srv->geometry_mtx);
+            srv->geometry_cv.wait(lock, [&]{ return !srv->geometry_jobs_queued.is_empty() or not srv->running.load(); });
+            if (srv->running.load()==false)
+                continue;
+            job = srv->geometry_jobs_queued[0];
+            srv->geometry_jobs_queued.remove_at(0);
+        }
+        build_geometry_job_steamaudio(srv->global_state, job);
+        {
+            std::unique_lock<std::mutex> lock(srv->geometry_mtx);
+            srv->geometry_jobs_built.push_back(job);
+        }
+    }
+}
+
+void SteamAudioServer::queue_geometry_job(GeometryJobSteamAudio * job) {
+    std::unique_lock<std::mutex> lock(geometry_mtx);
+    geometry_jobs_queued.push_back(job);
+    geometry_cv.notify_one();
+}
+
+void SteamAudioServer::commit_geometry_jobs(Vector<GeometryCommitSteamAudio>& committed) {
+    Vector<GeometryJobSteamAudio*> built;
+    {
+        std::unique_lock<std::mutex> lock(geometry_mtx);
+        built = geometry_jobs_built;
+        geometry_jobs_built.clear();
+    }
+    for (GeometryJobSteamAudio * job : built) {
+        SteamAudioGeometry * owner = Object::cast_to<SteamAudioGeometry>(ObjectDB::get_instance(job->owner_id));
+        if (owner) {
+            owner->commit_geometry_job(job);
+            GeometryCommitSteamAudio commit;
+            commit.owner_id = job->owner_id;
+            commit.error_code = job->error_code;
+            committed.push_back(commit);
+        }
+        //Only left non-empty when the owner was freed while the job was in flight
+        for (int midx = 0; midx < job->static_meshes.size(); midx++) {
+            IPLStaticMesh mesh_ptr = job->static_meshes[midx];
+            iplStaticMeshRelease(&mesh_ptr);
+        }
+        memdelete(job);
+    }
+}
+
+//The tree may already be gone at shutdown, so it is looked up by id
+void SteamAudioServer::disconnect_physics_tree() {
+    SceneTree * tree = Object::cast_to<SceneTree>(ObjectDB::get_instance(physics_tree_id));
+    if (tree) {
+        tree->disconnect("node_added", callable_mp(this, &SteamAudioServer::physics_node_added));
+        tree->disconnect("node_removed", callable_mp(this, &SteamAudioServer::physics_node_removed));
+    }
+    physics_tree_id = ObjectID();
+}
+
+void SteamAudioServer::physics_node_added(Node * node) {
+    track_physics_node_steamaudio(node, true, physics_snapshot_cache);
+}
+
+void SteamAudioServer::physics_node_removed(Node * node) {
+    track_physics_node_steamaudio(node, false, physics_snapshot_cache);
+}
+
+//The physics server isn't safe to query from the simulation threads, so the bodies are copied here on the main thread.
+//The tree is walked once, after that the SceneTree's node signals keep the list of bodies current
+void SteamAudioServer::update_physics_snapshot(uint64_t now_usec) {
+    //Still waiting for a commit point, rebuilding now would only be thrown away
+    if (pending_physics_snapshot) {
+        return;
+    }
+    if (global_state.physics_snapshot && now_usec - physics_snapshot_usec < global_state.physics_snapshot_interval_usec) {
+        return;
+    }
+    TRACE_SCOPE_STEAMAUDIO("physics_snapshot");
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SCENE_STEAMAUDIO);
+    SceneTree * tree = listener->get_tree();
+    if (tree->get_instance_id() != physics_tree_id) {
+        disconnect_physics_tree();
+        physics_tree_id = tree->get_instance_id();
+        tree->connect("node_added", callable_mp(this, &SteamAudioServer::physics_node_added));
+        tree->connect("node_removed", callable_mp(this, &SteamAudioServer::physics_node_removed));
+        physics_snapshot_cache.bodies.clear();
+        collect_physics_bodies_steamaudio(tree->get_root(), physics_snapshot_cache);
+    }
+    pending_physics_snapshot = build_physics_snapshot_steamaudio(listener->get_world_3d(), physics_snapshot_cache);
+    physics_snapshot_usec = now_usec;
+}
+
+void SteamAudioServer::release_physics_snapshots() {
+    if (pending_physics_snapshot) {
+        memdelete(pending_physics_snapshot);
+        pending_physics_snapshot = nullptr;
+    }
+    if (global_state.physics_snapshot) {
+        memdelete(global_state.physics_snapshot);
+        global_state.physics_snapshot = nullptr;
+    }
+    physics_snapshot_cache.shapes.clear();
+    physics_snapshot_cache.object_indices.clear();
+    physics_snapshot_cache.bodies.clear();
+    physics_snapshot_cache.last_shapes.clear();
+    disconnect_physics_tree();
+}
+
+IPLScene SteamAudioServer::acquire_sub_scene(const Ref<Mesh>& mesh) {
+    MEMORY_CATEGORY_STEAMAUDIO(MEMORY_CATEGORY_SCENE_STEAMAUDIO);
+    ObjectID mesh_id = mesh->get_instance_id();
+    SubSceneSteamAudio * sub_scene = sub_scenes.getptr(mesh_id);
+    if (sub_scene) {
+        sub_scene->ref_count++;
+        return sub_scene->scene;
+    }
+    if (global_state.scene_settings.type == IPL_SCENETYPE_CUSTOM) {
+        //Custom scenes can't hold instanced meshes
+        return nullptr;
+    }
+
+    SubSceneSteamAudio new_sub_scene;
+    IPLerror error_code = iplSceneCreate(global_state.phonon_ctx, &(global_state.scene_settings), &(new_sub_scene.scene));
+    if (error_code) {
+        printf("Err code for iplSceneCreate: %d\n", error_code);
+        return nullptr;
+    }
+    //Sub-scene geometry stays in mesh space, each instance supplies its own transform
+    create_mesh_static_meshes_steamaudio(global_state, new_sub_scene.scene, mesh, Transform3D(), new_sub_scene.static_meshes);
+    for (int midx = 0; midx < new_sub_scene.static_meshes.size(); midx++) {
+        iplStaticMeshAdd(new_sub_scene.static_meshes[midx], new_sub_scene.scene);
+    }
+    iplSceneCommit(new_sub_scene.scene);
+    new_sub_scene.ref_count = 1;
+    sub_scenes.insert(mesh_id, new_sub_scene);
+    return new_sub_scene.scene;
+}
+
+void SteamAudioServer::release_sub_scene(const Ref<Mesh>& mesh) {
+    ObjectID mesh_id = mesh->get_instance_id();
+    SubSceneSteamAudio * sub_scene = sub_scenes.getptr(mesh_id);
+    if (sub_scene == nullptr) {
+        return;
+    }
+    sub_scene->ref_count--;
+    if (sub_scene->ref_count > 0) {
+        return;
+    }
+    for (int midx = 0; midx < sub_scene->static_meshes.size(); midx++) {
+        IPLStaticMesh mesh_ptr = sub_scene->static_meshes[midx];
+        iplStaticMeshRemove(mesh_ptr, sub_scene->scene);
+        iplStaticMeshRelease(&mesh_ptr);
+    }
+    iplSceneRelease(&(sub_scene->scene));
+    sub_scenes.erase(mesh_id);
+}
+
+void SteamAudioServer::add_dynamic_instance(SteamAudioInstancedGeometry * instance) {
+    if (!dynamic_instances.has(instance)) {
+        dynamic_instances.push_back(instance);
+    }
+}
+
+void SteamAudioServer::remove_dynamic_instance(SteamAudioInstancedGeometry * instance) {
+    dynamic_instances.erase(instance);
+}
+
+void SteamAudioServer::add_reverb_zone(SteamAudioReverbZone * zone) {
+    if (!reverb_zones.has(zone)) {
+        reverb_zones.push_back(zone);
+    }
+}
+
+void SteamAudioServer::remove_reverb_zone(SteamAudioReverbZone * zone) {
+    reverb_zones.erase(zone);
+}
+
+//The player's reverb_time wins, then the smallest zone containing the source, 0 if neither applies.
+//A source keeps its zone until it is REVERB_ZONE_MARGIN_STEAMAUDIO past the edge, so one walking along
+//a boundary doesn't flip between two IR lengths
+float SteamAudioServer::get_ir_duration(LocalStateSteamAudio * local_state) {
+    float ir_duration = local_state->source.steamaudio_player->get_reverb_time();
+    if (ir_duration > 0.0f) {
+        local_state->reverb_zone = nullptr;
+        return ir_duration;
+    }
+    SteamAudioReverbZone * source_zone = nullptr;
+    //Sources out of the index aren't updated when a zone leaves the tree, so the zone is looked up first
+    if (reverb_zones.has(local_state->reverb_zone) && local_state->reverb_zone->has_point(local_state->published_source_pos, REVERB_ZONE_MARGIN_STEAMAUDIO)) {
+        source_zone = local_state->reverb_zone;
+    }
+    for (SteamAudioReverbZone * zone : reverb_zones) {
+        if ((source_zone == nullptr || zone->get_volume() < source_zone->get_volume()) && zone->has_point(local_state->published_source_pos)) {
+            source_zone = zone;
+        }
+    }
+    local_state->reverb_zone = source_zone;
+    return source_zone ? source_zone->get_reverb_time() : 0.0f;
+}
+
 SteamAudioServer::SteamAudioServer() {
     singleton = this;
 }
 
 SteamAudioServer::~SteamAudioServer() {
     SteamAudioServer::finish();
+    if (capture_file.is_valid()) {
+        end_capture_steamaudio(capture_file);
+    }
     if (global_state_initialized.load()==true) {
         deinit_global_state_steamaudio(global_state);
     }
+    release_trace_buffers_steamaudio();
 }
 
 SteamAudioServer* SteamAudioServer::singleton = nullptr;
@@ -209,14 +1639,73 @@ Error SteamAudioServer::init() {
     global_state_initialized.store(false);
     indirect_thread_processing.store(false);
     running.store(true);
-    indirect_thread.start(SteamAudioServer::indirect_worker, this);
+
+    reserved_cores = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/simulation/reserved_cores", PROPERTY_HINT_RANGE, "0,16,1"), 2);
+    pin_indirect_thread = GLOBAL_DEF_RST("steamaudio/simulation/pin_indirect_thread", false);
+    Thread::Settings indirect_thread_settings;
+    indirect_thread_priority = (Thread::Priority)(int)GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/simulation/indirect_thread_priority", PROPERTY_HINT_ENUM, "Low,Normal,High"), Thread::PRIORITY_LOW);
+    indirect_thread_settings.priority = indirect_thread_priority;
+    indirect_thread.start(SteamAudioServer::indirect_worker, this, indirect_thread_settings);
+    geometry_thread.start(SteamAudioServer::geometry_worker, this);
+
+    //A direct rate of 0 leaves simulation to tick(), as before the scheduler existed
+    direct_rate = GLOBAL_DEF_RST(PropertyInfo(Variant::FLOAT, "steamaudio/simulation/direct_rate", PROPERTY_HINT_RANGE, "0,240,1,suffix:Hz"), 60.0f);
+    source_index.set_cell_size(GLOBAL_DEF_RST(PropertyInfo(Variant::FLOAT, "steamaudio/simulation/source_index_cell_size", PROPERTY_HINT_RANGE, "0.5,100,0.5,suffix:m"), 8.0f));
+    cluster_radius = GLOBAL_DEF_RST(PropertyInfo(Variant::FLOAT, "steamaudio/simulation/cluster_radius", PROPERTY_HINT_RANGE, "0,10,0.05,suffix:m"), 0.0f);
+    reflection_rate = GLOBAL_DEF_RST(PropertyInfo(Variant::FLOAT, "steamaudio/simulation/reflection_rate", PROPERTY_HINT_RANGE, "0.5,60,0.5,suffix:Hz"), 10.0f);
+    source_pool_prewarm = GLOBAL_DEF_RST(PropertyInfo(Variant::INT, "steamaudio/simulation/source_pool_prewarm", PROPERTY_HINT_RANGE, "0,256,1"), 32);
+    if (direct_rate > 0.0f) {
+        scheduler_thread.start(SteamAudioServer::scheduler_worker, this);
+    }
     return OK;
 }
 
 void SteamAudioServer::finish() {
     running.store(false);
+    {
+        std::unique_lock<std::mutex> lock(state_mtx);
+        scheduler_cv.notify_one();
+    }
+    if (scheduler_thread.is_started()) {
+        scheduler_thread.wait_to_finish();
+    }
     cv.notify_one();
     indirect_thread.wait_to_finish();
+    {
+        std::unique_lock<std::mutex> lock(geometry_mtx);
+        geometry_cv.notify_one();
+    }
+    if (geometry_thread.is_started()) {
+        geometry_thread.wait_to_finish();
+    }
+    for (GeometryJobSteamAudio * job : geometry_jobs_queued) {
+        memdelete(job);
+    }
+    geometry_jobs_queued.clear();
+    for (GeometryJobSteamAudio * job : geometry_jobs_built) {
+        for (int midx = 0; midx < job->static_meshes.size(); midx++) {
+            IPLStaticMesh mesh_ptr = job->static_meshes[midx];
+            iplStaticMeshRelease(&mesh_ptr);
+        }
+        memdelete(job);
+    }
+    geometry_jobs_built.clear();
+    if (quality_thread.is_started()) {
+        quality_thread.wait_to_finish();
+    }
+    if (quality_staging) {
+        release_quality_staging();
+    }
+    if (global_state_initialized.load()) {
+        release_source_clusters();
+        release_source_pool();
+    }
+    release_physics_snapshots();
+    unregister_monitors();
+    if (mix_callback_registered && AudioServer::get_singleton()) {
+        AudioServer::get_singleton()->remove_mix_callback(SteamAudioServer::mix_block_started, this);
+        mix_callback_registered = false;
+    }
     return;
 }
 
@@ -234,21 +1723,35 @@ bool SteamAudioServer::deregister_listener() {
 }
 
 bool SteamAudioServer::add_source(LocalStateSteamAudio * local_state) {
-    for (LocalStateSteamAudio * source_state : local_states) {
-        if (source_state==local_state) {
-            return false;
-        }
+    LockTimerSteamAudio lock_timer("state_mtx: SteamAudioServer::add_source");
+    std::unique_lock<std::mutex> lock(state_mtx);
+    lock_timer.acquired();
+    if (source_index.has(local_state->source_index_handle)) {
+        return false;
     }
     iplSourceAdd(local_state->source.src, global_state.simulator);
-    local_states.push_back(local_state);
+    //Seed the pose so the scheduler doesn't simulate the source at the origin before the next tick()
+    local_state->published_source_pos = local_state->source.steamaudio_player->get_global_transform().origin;
+    local_state->source_index_handle = source_index.add(local_state, local_state->published_source_pos);
     
     return true;
 }
 
 bool SteamAudioServer::remove_source(LocalStateSteamAudio * local_state) {
-    if (local_states.has(local_state)) {
+    LockTimerSteamAudio lock_timer("state_mtx: SteamAudioServer::remove_source");
+    std::unique_lock<std::mutex> lock(state_mtx);
+    lock_timer.acquired();
+    if (source_index.has(local_state->source_index_handle)) {
+        if (local_state->cluster) {
+            local_state->cluster->members.erase(local_state);
+            local_state->cluster = nullptr;
+        }
         iplSourceRemove(local_state->source.src, global_state.simulator);
-        local_states.erase(local_state);
+        source_index.remove(local_state->source_index_handle);
+        local_state->source_index_handle = SOURCE_INDEX_INVALID_HANDLE_STEAMAUDIO;
+        return_source(local_state->source.src);
+        local_state->source.src = nullptr;
+        local_state->source.source_initialized = false;
         return true;
     }
     return false;
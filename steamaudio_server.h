@@ -26,17 +26,66 @@ SOFTWARE.
 #define STEAMAUDIO_SERVER_H
 
 #include "core/object/object.h"
+#include "core/io/file_access.h"
 #include "core/os/thread.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
 #include "godot_steamaudio.h"
 #include "steamaudio_listener.h"
+#include "steamaudio_memory.h"
+#include "steamaudio_physics_raytracer.h"
+#include "steamaudio_source_index.h"
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
+#include <chrono>
+
+#define MONITOR_WINDOW_USEC_STEAMAUDIO 1000000
+//How far past a reverb zone's edge, in the zone's local units, a source has to move before it leaves the zone
+#define REVERB_ZONE_MARGIN_STEAMAUDIO 0.5f
+
+struct GeometryJobSteamAudio {
+    ObjectID owner_id;
+    Transform3D xform;
+    Vector<PackedVector3Array> surface_verts;
+    Vector<PackedInt32Array> surface_indices;
+    Vector<IPLStaticMesh> static_meshes;
+    int error_code = 0;
+};
+
+struct GeometryCommitSteamAudio {
+    ObjectID owner_id;
+    int error_code = 0;
+};
+
+struct SubSceneSteamAudio {
+    IPLScene scene = nullptr;
+    Vector<IPLStaticMesh> static_meshes;
+    int ref_count = 0;
+};
+
+//Nearby sources share one proxy source for reflections, direct simulation stays per source
+struct SourceClusterSteamAudio {
+    IPLSource proxy = nullptr;
+    Vector3 center;
+    LocalVector<LocalStateSteamAudio*> members;
+    bool proxy_ready = false;
+    int empty_passes = 0;
+    int proxy_idle_passes = 0;
+};
+
+class SteamAudioInstancedGeometry;
+class SteamAudioSettings;
+class SteamAudioReverbZone;
 
 class SteamAudioServer : public Object {
     GDCLASS(SteamAudioServer, Object);
     static SteamAudioServer * singleton;
     static void indirect_worker(void *p_udata);
+    static void geometry_worker(void *p_udata);
+    static void scheduler_worker(void *p_udata);
+    static void quality_worker(void *p_udata);
+    static void mix_block_started(void *p_udata);
 private:
     GlobalStateSteamAudio global_state;
     std::mutex mtx;
@@ -44,9 +93,136 @@ private:
     std::atomic<bool> running;
     std::atomic<bool> indirect_thread_processing;
     Thread indirect_thread;
+    int reserved_cores = 0;
+    bool pin_indirect_thread = false;
+    Thread::Priority indirect_thread_priority = Thread::PRIORITY_LOW;
     std::atomic<bool> global_state_initialized;
     SteamAudioListener * listener = nullptr;
-    Vector<LocalStateSteamAudio*> local_states;
+    SourceIndexSteamAudio source_index;
+//Background geometry builds, committed from tick()
+    std::mutex geometry_mtx;
+    std::condition_variable geometry_cv;
+    Thread geometry_thread;
+    Vector<GeometryJobSteamAudio*> geometry_jobs_queued;
+    Vector<GeometryJobSteamAudio*> geometry_jobs_built;
+    void commit_geometry_jobs(Vector<GeometryCommitSteamAudio>& committed);
+//Instanced geometry: one sub-scene per unique mesh, shared by all of its instances
+    HashMap<ObjectID, SubSceneSteamAudio> sub_scenes;
+    Vector<SteamAudioInstancedGeometry*> dynamic_instances;
+//Physics raytracer snapshot, built by tick() and swapped in at the scene commit point
+    PhysicsSnapshotCacheSteamAudio physics_snapshot_cache;
+    PhysicsSnapshotSteamAudio * pending_physics_snapshot = nullptr;
+    uint64_t physics_snapshot_usec = 0;
+    ObjectID physics_tree_id;
+    void physics_node_added(Node * node);
+    void physics_node_removed(Node * node);
+    void disconnect_physics_tree();
+    void update_physics_snapshot(uint64_t now_usec);
+    void release_physics_snapshots();
+//Reverb zones, resolved per source in tick()
+    LocalVector<SteamAudioReverbZone*> reverb_zones;
+    float get_ir_duration(LocalStateSteamAudio * local_state);
+//Fixed-rate scheduler, tick() publishes poses and the scheduler simulates from them
+//state_mtx guards source_index, the published poses and the scene commit point
+    std::mutex state_mtx;
+    std::condition_variable scheduler_cv;
+    Thread scheduler_thread;
+    float direct_rate = 0.0f;
+    float reflection_rate = 0.0f;
+    IPLCoordinateSpace3 published_listener{};
+    bool poses_published = false;
+    uint64_t published_usec = 0;
+    uint64_t reflection_pose_usec = 0;
+    bool reflection_outputs_pending = false;
+    std::atomic<uint64_t> direct_ticks_skipped = 0;
+    std::atomic<uint64_t> reflection_ticks_skipped = 0;
+//The scheduler runs the direct pass without state_mtx, direct_processing is only read and written with it held
+    bool direct_processing = false;
+    std::condition_variable direct_cv;
+    IPLCoordinateSpace3 direct_listener{};
+    uint64_t direct_pose_usec = 0;
+    uint64_t direct_start_usec = 0;
+    void run_direct_simulation();
+    void prepare_direct_simulation();
+    void publish_direct_simulation();
+    void wait_for_direct_pass(std::unique_lock<std::mutex>& lock);
+//Source clustering, only touched with state_mtx held and no reflection pass running
+    float cluster_radius = 0.0f;
+    LocalVector<SourceClusterSteamAudio*> clusters;
+    void update_source_clusters();
+    void release_cluster_proxy(SourceClusterSteamAudio * cluster);
+    void release_source_clusters();
+//IPLSource pool, returned sources wait for the next simulator commit before reuse
+    LocalVector<IPLSource> source_pool;
+    LocalVector<IPLSource> sources_pending_return;
+    int sources_checked_out = 0;
+    int cluster_proxies = 0;
+    int get_num_pool_sources() const;
+    void recycle_returned_sources();
+    IPLSource take_pool_source();
+    int source_pool_prewarm = 0;
+    void prewarm_source_pool();
+//Quality changes: the simulator, sources and playback resources are built on quality_thread,
+//then apply_quality_swap() swaps them in from tick() under the AudioServer lock. Nothing is created under the lock,
+//players past the new source limit lose their sources farthest first
+    LocalVector<AudioStreamPlaybackSteamAudio*> playbacks;
+    Thread quality_thread;
+    std::atomic<bool> quality_swap_pending = false;
+    std::atomic<bool> quality_swap_ready = false;
+    GlobalStateSteamAudio * quality_staging = nullptr;
+    MemoryLedgerSteamAudio * quality_memory_ledger = nullptr;
+    int quality_num_sources = 0;
+    int quality_error_code = 0;
+    bool quality_swap_in_progress = false; //Guarded by state_mtx, keeps the scheduler out
+    LocalVector<IPLSource> quality_sources;
+    LocalVector<AudioStreamPlaybackSteamAudio*> quality_playbacks;
+    LocalVector<QualityResourcesSteamAudio> quality_resources;
+    void apply_quality_swap();
+    void release_quality_staging();
+    void return_source(IPLSource src);
+    void release_source_pool();
+    bool run_reflection_simulation();
+    void publish_reflection_outputs();
+//Performance monitors, registered from the first tick() after Performance exists
+    enum MonitorSteamAudio {
+        MONITOR_TICK_MSEC,
+        MONITOR_DIRECT_MSEC,
+        MONITOR_REFLECTIONS_MSEC,
+        MONITOR_REFLECTIONS_PER_SEC,
+        MONITOR_SOURCES_ACTIVE,
+        MONITOR_SOURCES_VIRTUAL,
+        MONITOR_SOURCES_REGISTERED,
+        MONITOR_SPATIALIZE_MIN_MSEC,
+        MONITOR_SPATIALIZE_AVG_MSEC,
+        MONITOR_SPATIALIZE_P99_MSEC,
+        MONITOR_EFFECT_MEMORY_KIB,
+        MONITOR_BUFFER_MEMORY_KIB,
+        MONITOR_HRTF_MEMORY_KIB,
+        MONITOR_SCENE_MEMORY_KIB,
+        MONITOR_SIMULATOR_MEMORY_KIB,
+        MONITOR_TOTAL_MEMORY_KIB,
+        MONITOR_DIRECT_STALE_READS,
+        MONITOR_REFLECTION_STALE_READS,
+        MONITOR_MIX_MAX_MSEC,
+        MONITOR_MIX_OVERRUNS,
+        MONITOR_REALTIME_VIOLATIONS,
+        MONITOR_LOCK_WAIT_MAX_MSEC,
+        MONITOR_LOCK_HOLD_MAX_MSEC,
+        MONITOR_MAX
+    };
+    bool monitors_registered = false;
+    bool mix_callback_registered = false;
+    uint64_t monitor_window_start_usec = 0;
+    uint64_t monitor_reflection_runs = 0;
+    double monitor_values[MONITOR_MAX] = {};
+    void register_monitors();
+    void unregister_monitors();
+    void update_monitor_window(uint64_t now_usec);
+    double get_monitor_value(int monitor);
+    void wait_for_reflection_pass();
+//Capture file written by tick() between start_capture() and stop_capture()
+    Ref<FileAccess> capture_file;
+    void capture_tick();
 //Shared Data: SteamAudio Simulator Inputs
     
 protected:
@@ -61,7 +237,31 @@ public:
     bool deregister_listener();
     bool add_source(LocalStateSteamAudio * local_state);
     bool remove_source(LocalStateSteamAudio * local_state);
+    void register_playback(AudioStreamPlaybackSteamAudio * playback);
+    void deregister_playback(AudioStreamPlaybackSteamAudio * playback);
+    IPLSource checkout_source();
+    void queue_geometry_job(GeometryJobSteamAudio * job);
+    IPLScene acquire_sub_scene(const Ref<Mesh>& mesh);
+    void release_sub_scene(const Ref<Mesh>& mesh);
+    void add_dynamic_instance(SteamAudioInstancedGeometry * instance);
+    void remove_dynamic_instance(SteamAudioInstancedGeometry * instance);
+    void add_reverb_zone(SteamAudioReverbZone * zone);
+    void remove_reverb_zone(SteamAudioReverbZone * zone);
     GlobalStateSteamAudio* clone_global_state();    
+    Dictionary get_geometry_stats();
+    Dictionary get_simulation_stats();
+    Dictionary get_memory_usage();
+    Error set_settings(const Ref<SteamAudioSettings>& settings);
+    Ref<SteamAudioSettings> get_settings();
+    Array get_sources_in_radius(const Vector3& center, float radius);
+    Array get_nearest_sources(const Vector3& center, int count);
+    Dictionary render_offline(const String& path, float duration);
+    Error start_trace(const String& path);
+    Error stop_trace();
+    Error start_capture(const String& path);
+    Error stop_capture();
+    Dictionary replay_capture(const String& path, const String& wav_path = "");
+    Dictionary benchmark_raytracers(int subdivisions = 16, int iterations = 4);
     
     SteamAudioServer();
     ~SteamAudioServer();
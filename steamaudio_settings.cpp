@@ -0,0 +1,169 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_settings.h"
+
+SteamAudioSettings::SteamAudioSettings() {
+    quality = quality_preset_steamaudio(tier);
+}
+
+SteamAudioSettings::~SteamAudioSettings() {
+}
+
+//Editing a value the tier's preset disagrees with turns the settings into a custom tier
+void SteamAudioSettings::update_tier() {
+    if (tier == TIER_CUSTOM) {
+        return;
+    }
+    QualitySettingsSteamAudio preset = quality_preset_steamaudio(tier);
+    if (preset.ambisonics_order != quality.ambisonics_order ||
+        preset.max_num_rays != quality.max_num_rays ||
+        preset.num_diffuse_samples != quality.num_diffuse_samples ||
+        preset.max_duration != quality.max_duration ||
+        preset.max_num_sources != quality.max_num_sources ||
+        preset.num_bounces != quality.num_bounces) {
+        tier = TIER_CUSTOM;
+    }
+}
+
+void SteamAudioSettings::set_tier(Tier p_tier) {
+    ERR_FAIL_INDEX((int)p_tier, TIER_CUSTOM + 1);
+    tier = p_tier;
+    if (tier != TIER_CUSTOM) {
+        quality = quality_preset_steamaudio(tier);
+    }
+    emit_changed();
+}
+
+SteamAudioSettings::Tier SteamAudioSettings::get_tier() const {
+    return tier;
+}
+
+void SteamAudioSettings::set_ambisonics_order(int p_order) {
+    quality.ambisonics_order = CLAMP(p_order, 0, 3);
+    update_tier();
+    emit_changed();
+}
+
+int SteamAudioSettings::get_ambisonics_order() const {
+    return quality.ambisonics_order;
+}
+
+void SteamAudioSettings::set_max_num_rays(int p_rays) {
+    quality.max_num_rays = MAX(p_rays, 1);
+    update_tier();
+    emit_changed();
+}
+
+int SteamAudioSettings::get_max_num_rays() const {
+    return quality.max_num_rays;
+}
+
+void SteamAudioSettings::set_num_diffuse_samples(int p_samples) {
+    quality.num_diffuse_samples = MAX(p_samples, 1);
+    update_tier();
+    emit_changed();
+}
+
+int SteamAudioSettings::get_num_diffuse_samples() const {
+    return quality.num_diffuse_samples;
+}
+
+void SteamAudioSettings::set_max_duration(float p_duration) {
+    quality.max_duration = MAX(p_duration, 0.1f);
+    update_tier();
+    emit_changed();
+}
+
+float SteamAudioSettings::get_max_duration() const {
+    return quality.max_duration;
+}
+
+void SteamAudioSettings::set_max_num_sources(int p_sources) {
+    quality.max_num_sources = MAX(p_sources, 1);
+    update_tier();
+    emit_changed();
+}
+
+int SteamAudioSettings::get_max_num_sources() const {
+    return quality.max_num_sources;
+}
+
+void SteamAudioSettings::set_num_bounces(int p_bounces) {
+    quality.num_bounces = MAX(p_bounces, 1);
+    update_tier();
+    emit_changed();
+}
+
+int SteamAudioSettings::get_num_bounces() const {
+    return quality.num_bounces;
+}
+
+void SteamAudioSettings::set_quality(const QualitySettingsSteamAudio& p_quality) {
+    quality = p_quality;
+    tier = TIER_CUSTOM;
+    for (int preset = TIER_LOW; preset < TIER_CUSTOM; preset++) {
+        tier = (Tier)preset;
+        update_tier();
+        if (tier != TIER_CUSTOM) {
+            break;
+        }
+    }
+    emit_changed();
+}
+
+const QualitySettingsSteamAudio& SteamAudioSettings::get_quality() const {
+    return quality;
+}
+
+void SteamAudioSettings::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_tier", "tier"), &SteamAudioSettings::set_tier);
+	ClassDB::bind_method(D_METHOD("get_tier"), &SteamAudioSettings::get_tier);
+	ClassDB::bind_method(D_METHOD("set_ambisonics_order", "order"), &SteamAudioSettings::set_ambisonics_order);
+	ClassDB::bind_method(D_METHOD("get_ambisonics_order"), &SteamAudioSettings::get_ambisonics_order);
+	ClassDB::bind_method(D_METHOD("set_max_num_rays", "rays"), &SteamAudioSettings::set_max_num_rays);
+	ClassDB::bind_method(D_METHOD("get_max_num_rays"), &SteamAudioSettings::get_max_num_rays);
+	ClassDB::bind_method(D_METHOD("set_num_diffuse_samples", "samples"), &SteamAudioSettings::set_num_diffuse_samples);
+	ClassDB::bind_method(D_METHOD("get_num_diffuse_samples"), &SteamAudioSettings::get_num_diffuse_samples);
+	ClassDB::bind_method(D_METHOD("set_max_duration", "duration"), &SteamAudioSettings::set_max_duration);
+	ClassDB::bind_method(D_METHOD("get_max_duration"), &SteamAudioSettings::get_max_duration);
+	ClassDB::bind_method(D_METHOD("set_max_num_sources", "sources"), &SteamAudioSettings::set_max_num_sources);
+	ClassDB::bind_method(D_METHOD("get_max_num_sources"), &SteamAudioSettings::get_max_num_sources);
+	ClassDB::bind_method(D_METHOD("set_num_bounces", "bounces"), &SteamAudioSettings::set_num_bounces);
+	ClassDB::bind_method(D_METHOD("get_num_bounces"), &SteamAudioSettings::get_num_bounces);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "tier", PROPERTY_HINT_ENUM, "Low,Medium,High,Ultra,Custom"), "set_tier", "get_tier");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "ambisonics_order", PROPERTY_HINT_RANGE, "0,3,1"), "set_ambisonics_order", "get_ambisonics_order");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_num_rays", PROPERTY_HINT_RANGE, "256,16384,1"), "set_max_num_rays", "get_max_num_rays");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "num_diffuse_samples", PROPERTY_HINT_RANGE, "8,256,1"), "set_num_diffuse_samples", "get_num_diffuse_samples");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "max_duration", PROPERTY_HINT_RANGE, "0.1,4,0.1,suffix:s"), "set_max_duration", "get_max_duration");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_num_sources", PROPERTY_HINT_RANGE, "1,1024,1"), "set_max_num_sources", "get_max_num_sources");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "num_bounces", PROPERTY_HINT_RANGE, "1,64,1"), "set_num_bounces", "get_num_bounces");
+
+	BIND_ENUM_CONSTANT(TIER_LOW);
+	BIND_ENUM_CONSTANT(TIER_MEDIUM);
+	BIND_ENUM_CONSTANT(TIER_HIGH);
+	BIND_ENUM_CONSTANT(TIER_ULTRA);
+	BIND_ENUM_CONSTANT(TIER_CUSTOM);
+}
@@ -0,0 +1,70 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_SETTINGS_H
+#define STEAMAUDIO_SETTINGS_H
+
+#include "core/io/resource.h"
+#include "godot_steamaudio.h"
+
+//Simulation quality, applied at runtime with SteamAudioServer.set_settings()
+class SteamAudioSettings : public Resource {
+    GDCLASS(SteamAudioSettings, Resource);
+public:
+    enum Tier {
+        TIER_LOW = QUALITY_TIER_LOW_STEAMAUDIO,
+        TIER_MEDIUM = QUALITY_TIER_MEDIUM_STEAMAUDIO,
+        TIER_HIGH = QUALITY_TIER_HIGH_STEAMAUDIO,
+        TIER_ULTRA = QUALITY_TIER_ULTRA_STEAMAUDIO,
+        TIER_CUSTOM = QUALITY_TIER_CUSTOM_STEAMAUDIO,
+    };
+    SteamAudioSettings();
+    ~SteamAudioSettings();
+    void set_tier(Tier p_tier);
+    Tier get_tier() const;
+    void set_ambisonics_order(int p_order);
+    int get_ambisonics_order() const;
+    void set_max_num_rays(int p_rays);
+    int get_max_num_rays() const;
+    void set_num_diffuse_samples(int p_samples);
+    int get_num_diffuse_samples() const;
+    void set_max_duration(float p_duration);
+    float get_max_duration() const;
+    void set_max_num_sources(int p_sources);
+    int get_max_num_sources() const;
+    void set_num_bounces(int p_bounces);
+    int get_num_bounces() const;
+    void set_quality(const QualitySettingsSteamAudio& p_quality);
+    const QualitySettingsSteamAudio& get_quality() const;
+protected:
+    static void _bind_methods();
+private:
+    Tier tier = TIER_HIGH;
+    QualitySettingsSteamAudio quality;
+    void update_tier();
+};
+
+VARIANT_ENUM_CAST(SteamAudioSettings::Tier)
+
+#endif // STEAMAUDIO_SETTINGS_H
@@ -0,0 +1,262 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_source_index.h"
+#include "core/math/math_funcs.h"
+
+void SourceIndexSteamAudio::set_cell_size(float p_cell_size) {
+    cell_size = MAX(p_cell_size, 0.01f);
+    //Rebin everything under the new cell size
+    cell_map.clear();
+    for (uint32_t dense_idx = 0; dense_idx < sources.size(); dense_idx++) {
+        cells[dense_idx] = cell_for(positions[dense_idx]);
+        insert_into_cell(dense_idx);
+    }
+}
+
+Vector3i SourceIndexSteamAudio::cell_for(const Vector3& position) const {
+    return Vector3i((int)Math::floor(position.x / cell_size),
+                    (int)Math::floor(position.y / cell_size),
+                    (int)Math::floor(position.z / cell_size));
+}
+
+void SourceIndexSteamAudio::insert_into_cell(uint32_t dense_idx) {
+    LocalVector<uint32_t> * cell = cell_map.getptr(cells[dense_idx]);
+    if (cell == nullptr) {
+        cell_map.insert(cells[dense_idx], LocalVector<uint32_t>());
+        cell = cell_map.getptr(cells[dense_idx]);
+    }
+    cell_slots[dense_idx] = cell->size();
+    cell->push_back(dense_idx);
+}
+
+void SourceIndexSteamAudio::remove_from_cell(uint32_t dense_idx) {
+    LocalVector<uint32_t> * cell = cell_map.getptr(cells[dense_idx]);
+    if (cell == nullptr) {
+        return;
+    }
+    uint32_t cell_slot = cell_slots[dense_idx];
+    uint32_t moved_idx = (*cell)[cell->size() - 1];
+    (*cell)[cell_slot] = moved_idx;
+    cell_slots[moved_idx] = cell_slot;
+    cell->resize(cell->size() - 1);
+    if (cell->is_empty()) {
+        cell_map.erase(cells[dense_idx]);
+    }
+}
+
+uint32_t SourceIndexSteamAudio::add(LocalStateSteamAudio * source, const Vector3& position) {
+    uint32_t handle;
+    if (!free_handles.is_empty()) {
+        handle = free_handles[free_handles.size() - 1];
+        free_handles.resize(free_handles.size() - 1);
+    } else {
+        handle = handle_slots.size();
+        handle_slots.push_back(0);
+    }
+
+    uint32_t dense_idx = sources.size();
+    sources.push_back(source);
+    positions.push_back(position);
+    cells.push_back(cell_for(position));
+    cell_slots.push_back(0);
+    slot_handles.push_back(handle);
+    handle_slots[handle] = dense_idx;
+    insert_into_cell(dense_idx);
+    return handle;
+}
+
+void SourceIndexSteamAudio::remove(uint32_t handle) {
+    if (!has(handle)) {
+        return;
+    }
+    uint32_t dense_idx = handle_slots[handle];
+    remove_from_cell(dense_idx);
+
+    uint32_t last_idx = sources.size() - 1;
+    if (dense_idx != last_idx) {
+        //Swap the last source into the hole and repoint its handle and cell entry
+        sources[dense_idx] = sources[last_idx];
+        positions[dense_idx] = positions[last_idx];
+        cells[dense_idx] = cells[last_idx];
+        cell_slots[dense_idx] = cell_slots[last_idx];
+        slot_handles[dense_idx] = slot_handles[last_idx];
+        handle_slots[slot_handles[dense_idx]] = dense_idx;
+        LocalVector<uint32_t> * cell = cell_map.getptr(cells[dense_idx]);
+        if (cell) {
+            (*cell)[cell_slots[dense_idx]] = dense_idx;
+        }
+    }
+    sources.resize(last_idx);
+    positions.resize(last_idx);
+    cells.resize(last_idx);
+    cell_slots.resize(last_idx);
+    slot_handles.resize(last_idx);
+
+    handle_slots[handle] = SOURCE_INDEX_INVALID_HANDLE_STEAMAUDIO;
+    free_handles.push_back(handle);
+}
+
+void SourceIndexSteamAudio::update(uint32_t handle, const Vector3& position) {
+    if (!has(handle)) {
+        return;
+    }
+    uint32_t dense_idx = handle_slots[handle];
+    positions[dense_idx] = position;
+    Vector3i new_cell = cell_for(position);
+    if (new_cell == cells[dense_idx]) {
+        return;
+    }
+    remove_from_cell(dense_idx);
+    cells[dense_idx] = new_cell;
+    insert_into_cell(dense_idx);
+}
+
+bool SourceIndexSteamAudio::has(uint32_t handle) const {
+    return handle < handle_slots.size() && handle_slots[handle] != SOURCE_INDEX_INVALID_HANDLE_STEAMAUDIO;
+}
+
+void SourceIndexSteamAudio::clear() {
+    sources.clear();
+    positions.clear();
+    cells.clear();
+    cell_slots.clear();
+    slot_handles.clear();
+    handle_slots.clear();
+    free_handles.clear();
+    cell_map.clear();
+}
+
+void SourceIndexSteamAudio::query_radius(const Vector3& center, float radius, LocalVector<LocalStateSteamAudio*>& results) const {
+    results.clear();
+    float radius_sq = radius * radius;
+    Vector3i cell_min = cell_for(center - Vector3(radius, radius, radius));
+    Vector3i cell_max = cell_for(center + Vector3(radius, radius, radius));
+    uint64_t num_cells = (uint64_t)(cell_max.x - cell_min.x + 1) * (cell_max.y - cell_min.y + 1) * (cell_max.z - cell_min.z + 1);
+
+    //Large radii touch more empty cells than there are occupied ones, just test every source
+    if (num_cells > cell_map.size()) {
+        for (uint32_t dense_idx = 0; dense_idx < sources.size(); dense_idx++) {
+            if (positions[dense_idx].distance_squared_to(center) <= radius_sq) {
+                results.push_back(sources[dense_idx]);
+            }
+        }
+        return;
+    }
+
+    for (int cell_x = cell_min.x; cell_x <= cell_max.x; cell_x++) {
+        for (int cell_y = cell_min.y; cell_y <= cell_max.y; cell_y++) {
+            for (int cell_z = cell_min.z; cell_z <= cell_max.z; cell_z++) {
+                const LocalVector<uint32_t> * cell = cell_map.getptr(Vector3i(cell_x, cell_y, cell_z));
+                if (cell == nullptr) {
+                    continue;
+                }
+                for (uint32_t dense_idx : *cell) {
+                    if (positions[dense_idx].distance_squared_to(center) <= radius_sq) {
+                        results.push_back(sources[dense_idx]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+//Keeps best_* sorted ascending by distance with at most count entries
+static void insert_nearest_candidate_steamaudio(float dist_sq, uint32_t dense_idx, int count, LocalVector<float>& best_dist_sq, LocalVector<uint32_t>& best_idx) {
+    if ((int)best_idx.size() == count) {
+        if (dist_sq >= best_dist_sq[count - 1]) {
+            return;
+        }
+        best_dist_sq.resize(count - 1);
+        best_idx.resize(count - 1);
+    }
+    uint32_t insert_at = best_idx.size();
+    while (insert_at > 0 && best_dist_sq[insert_at - 1] > dist_sq) {
+        insert_at--;
+    }
+    best_dist_sq.insert(insert_at, dist_sq);
+    best_idx.insert(insert_at, dense_idx);
+}
+
+//Grows a cube of cells around center ring by ring until the k best candidates
+//are closer than anything an unvisited ring could hold
+void SourceIndexSteamAudio::query_nearest(const Vector3& center, int count, LocalVector<LocalStateSteamAudio*>& results) const {
+    results.clear();
+    if (count <= 0 || sources.is_empty()) {
+        return;
+    }
+    count = MIN(count, (int)sources.size());
+
+    LocalVector<float> best_dist_sq;
+    LocalVector<uint32_t> best_idx;
+    uint32_t visited = 0;
+    bool brute_force = false;
+    Vector3i center_cell = cell_for(center);
+
+    for (int ring = 0; visited < sources.size(); ring++) {
+        if ((int)best_idx.size() == count) {
+            //Nothing in this ring or beyond is nearer than ring-1 whole cells
+            float ring_dist = (ring - 1) * cell_size;
+            if (ring_dist > 0.0f && ring_dist * ring_dist > best_dist_sq[count - 1]) {
+                break;
+            }
+        }
+        //Sparse sources, the ring would cost more cell lookups than testing every source
+        uint64_t ring_cells = (uint64_t)(2 * ring + 1) * (2 * ring + 1) * (2 * ring + 1);
+        if (ring > 0 && ring_cells > sources.size()) {
+            brute_force = true;
+            break;
+        }
+        for (int cell_x = center_cell.x - ring; cell_x <= center_cell.x + ring; cell_x++) {
+            for (int cell_y = center_cell.y - ring; cell_y <= center_cell.y + ring; cell_y++) {
+                for (int cell_z = center_cell.z - ring; cell_z <= center_cell.z + ring; cell_z++) {
+                    int ring_dist = MAX(ABS(cell_x - center_cell.x), MAX(ABS(cell_y - center_cell.y), ABS(cell_z - center_cell.z)));
+                    if (ring_dist != ring) {
+                        continue;
+                    }
+                    const LocalVector<uint32_t> * cell = cell_map.getptr(Vector3i(cell_x, cell_y, cell_z));
+                    if (cell == nullptr) {
+                        continue;
+                    }
+                    for (uint32_t dense_idx : *cell) {
+                        visited++;
+                        insert_nearest_candidate_steamaudio(positions[dense_idx].distance_squared_to(center), dense_idx, count, best_dist_sq, best_idx);
+                    }
+                }
+            }
+        }
+    }
+
+    if (brute_force) {
+        best_dist_sq.clear();
+        best_idx.clear();
+        for (uint32_t dense_idx = 0; dense_idx < sources.size(); dense_idx++) {
+            insert_nearest_candidate_steamaudio(positions[dense_idx].distance_squared_to(center), dense_idx, count, best_dist_sq, best_idx);
+        }
+    }
+
+    for (uint32_t dense_idx : best_idx) {
+        results.push_back(sources[dense_idx]);
+    }
+}
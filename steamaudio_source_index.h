@@ -0,0 +1,74 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_SOURCE_INDEX_H
+#define STEAMAUDIO_SOURCE_INDEX_H
+
+#include "core/math/vector3.h"
+#include "core/math/vector3i.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+
+struct LocalStateSteamAudio;
+
+#define SOURCE_INDEX_INVALID_HANDLE_STEAMAUDIO UINT32_MAX
+
+//Uniform spatial hash over source positions. Sources are kept densely packed
+//for iteration, handles map to their dense slot so add/remove/update are O(1)
+//(removal swaps the last source into the freed slot)
+class SourceIndexSteamAudio {
+public:
+    void set_cell_size(float p_cell_size);
+    uint32_t add(LocalStateSteamAudio * source, const Vector3& position);
+    void remove(uint32_t handle);
+    void update(uint32_t handle, const Vector3& position);
+    bool has(uint32_t handle) const;
+    void clear();
+
+    const LocalVector<LocalStateSteamAudio*>& get_sources() const { return sources; }
+    uint32_t size() const { return sources.size(); }
+
+    void query_radius(const Vector3& center, float radius, LocalVector<LocalStateSteamAudio*>& results) const;
+    void query_nearest(const Vector3& center, int count, LocalVector<LocalStateSteamAudio*>& results) const;
+
+private:
+    Vector3i cell_for(const Vector3& position) const;
+    void insert_into_cell(uint32_t dense_idx);
+    void remove_from_cell(uint32_t dense_idx);
+
+    float cell_size = 8.0f;
+    //Dense, parallel arrays indexed by slot
+    LocalVector<LocalStateSteamAudio*> sources;
+    LocalVector<Vector3> positions;
+    LocalVector<Vector3i> cells;
+    LocalVector<uint32_t> cell_slots;
+    LocalVector<uint32_t> slot_handles;
+    //Handle -> dense slot, freed handles are reused
+    LocalVector<uint32_t> handle_slots;
+    LocalVector<uint32_t> free_handles;
+    //Cell -> dense slots of the sources inside it
+    HashMap<Vector3i, LocalVector<uint32_t>> cell_map;
+};
+
+#endif // STEAMAUDIO_SOURCE_INDEX_H
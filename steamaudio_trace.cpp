@@ -0,0 +1,187 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "steamaudio_trace.h"
+#include "steamaudio_lockfree.h"
+#include "core/io/file_access.h"
+#include "core/os/thread.h"
+#include <stdio.h>
+
+std::atomic<bool> trace_enabled_steamaudio = false;
+//Bumped by every start and by release, a thread's cached buffer is only valid for the session it was claimed in
+static std::atomic<uint32_t> trace_session_steamaudio = 0;
+static std::atomic<uint32_t> trace_next_buffer_steamaudio = 0;
+static std::atomic<uint32_t> trace_dropped_threads_steamaudio = 0;
+//Allocated by the first start_trace_steamaudio() and kept until release_trace_buffers_steamaudio() at shutdown
+static std::atomic<TraceBufferSteamAudio*> trace_buffers_steamaudio = nullptr;
+static String trace_path_steamaudio;
+static uint64_t trace_start_usec_steamaudio = 0;
+static thread_local TraceBufferSteamAudio * trace_buffer_steamaudio = nullptr;
+static thread_local uint32_t trace_buffer_session_steamaudio = 0;
+static thread_local const char * trace_thread_name_tls_steamaudio = nullptr;
+
+//Never allocates or locks, so spans are safe on the audio thread. Returns nullptr once every buffer is taken
+static TraceBufferSteamAudio * get_trace_buffer_steamaudio() {
+    uint32_t session = trace_session_steamaudio.load(std::memory_order_acquire);
+    if (trace_buffer_session_steamaudio == session) {
+        return trace_buffer_steamaudio;
+    }
+    trace_buffer_session_steamaudio = session;
+    trace_buffer_steamaudio = nullptr;
+    TraceBufferSteamAudio * buffers = trace_buffers_steamaudio.load(std::memory_order_acquire);
+    if (buffers == nullptr) {
+        return nullptr;
+    }
+    uint32_t idx = trace_next_buffer_steamaudio.fetch_add(1, std::memory_order_relaxed);
+    if (idx >= TRACE_MAX_THREADS_STEAMAUDIO) {
+        trace_dropped_threads_steamaudio.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    TraceBufferSteamAudio * buffer = &buffers[idx];
+    buffer->thread_id = Thread::get_caller_id();
+    buffer->thread_name = Thread::is_main_thread() ? "main" : trace_thread_name_tls_steamaudio;
+    buffer->dropped.store(0, std::memory_order_relaxed);
+    buffer->count.store(0, std::memory_order_release);
+    trace_buffer_steamaudio = buffer;
+    return buffer;
+}
+
+//Only safe once nothing can record spans anymore. Cached buffers on every thread go stale with the session bump
+void release_trace_buffers_steamaudio() {
+    trace_enabled_steamaudio.store(false);
+    TraceBufferSteamAudio * buffers = trace_buffers_steamaudio.exchange(nullptr);
+    trace_session_steamaudio.fetch_add(1, std::memory_order_release);
+    if (buffers) {
+        memdelete_arr(buffers);
+    }
+}
+
+void trace_thread_name_steamaudio(const char * name) {
+    trace_thread_name_tls_steamaudio = name;
+    if (trace_buffer_steamaudio && trace_buffer_session_steamaudio == trace_session_steamaudio.load(std::memory_order_acquire)) {
+        trace_buffer_steamaudio->thread_name = name;
+    }
+}
+
+void record_trace_event_steamaudio(const char * name, uint64_t start_usec, uint64_t end_usec) {
+    TraceBufferSteamAudio * buffer = get_trace_buffer_steamaudio();
+    if (buffer == nullptr) {
+        return;
+    }
+    uint32_t idx = buffer->count.load(std::memory_order_relaxed);
+    if (idx >= TRACE_BUFFER_EVENTS_STEAMAUDIO) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer->events[idx].name = name;
+    buffer->events[idx].start_usec = start_usec;
+    buffer->events[idx].duration_usec = end_usec - start_usec;
+    buffer->count.store(idx + 1, std::memory_order_release);
+}
+
+TraceScopeSteamAudio::TraceScopeSteamAudio(const char * p_name) {
+    name = p_name;
+    active = trace_enabled_steamaudio.load(std::memory_order_relaxed);
+    if (active) {
+        start_usec = ticks_usec_steamaudio();
+    }
+}
+
+TraceScopeSteamAudio::~TraceScopeSteamAudio() {
+    if (active) {
+        record_trace_event_steamaudio(name, start_usec, ticks_usec_steamaudio());
+    }
+}
+
+Error start_trace_steamaudio(const String& path) {
+    if (trace_enabled_steamaudio.load()) {
+        return ERR_ALREADY_IN_USE;
+    }
+    //Every buffer is allocated up front, threads only claim one when they record their first span
+    if (trace_buffers_steamaudio.load() == nullptr) {
+        trace_buffers_steamaudio.store(memnew_arr(TraceBufferSteamAudio, TRACE_MAX_THREADS_STEAMAUDIO));
+    }
+    trace_path_steamaudio = path;
+    trace_start_usec_steamaudio = ticks_usec_steamaudio();
+    trace_next_buffer_steamaudio.store(0);
+    trace_dropped_threads_steamaudio.store(0);
+    trace_session_steamaudio.fetch_add(1, std::memory_order_release);
+    trace_enabled_steamaudio.store(true);
+    return OK;
+}
+
+//Writes every buffer recorded in this session as Chrome trace JSON, loadable in chrome://tracing or Perfetto
+Error stop_trace_steamaudio() {
+    if (!trace_enabled_steamaudio.load()) {
+        return ERR_DOES_NOT_EXIST;
+    }
+    trace_enabled_steamaudio.store(false);
+
+    Error err = OK;
+    Ref<FileAccess> file = FileAccess::open(trace_path_steamaudio, FileAccess::WRITE, &err);
+    if (err != OK) {
+        printf("Err code for trace file open: %d\n", err);
+        return err;
+    }
+
+    char line[256];
+    int len = 0;
+    bool first = true;
+    uint32_t dropped = 0;
+    TraceBufferSteamAudio * buffers = trace_buffers_steamaudio.load();
+    uint32_t num_buffers = MIN(trace_next_buffer_steamaudio.load(std::memory_order_acquire), (uint32_t)TRACE_MAX_THREADS_STEAMAUDIO);
+    file->store_string("{\"traceEvents\":[\n");
+    for (uint32_t bidx = 0; bidx < num_buffers; bidx++) {
+        TraceBufferSteamAudio * buffer = &buffers[bidx];
+        uint32_t count = buffer->count.load(std::memory_order_acquire);
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+        if (buffer->thread_name) {
+            len = snprintf(line, sizeof(line), "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%llu,\"args\":{\"name\":\"%s\"}}",
+                           first ? "" : ",\n", (unsigned long long)buffer->thread_id, buffer->thread_name);
+            file->store_buffer((const uint8_t *)line, len);
+            first = false;
+        }
+        for (uint32_t eidx = 0; eidx < count; eidx++) {
+            const TraceEventSteamAudio& event = buffer->events[eidx];
+            //A span that was already open when this session started
+            if (event.start_usec < trace_start_usec_steamaudio) {
+                continue;
+            }
+            len = snprintf(line, sizeof(line), "%s{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%llu,\"ts\":%llu,\"dur\":%llu}",
+                           first ? "" : ",\n", event.name, (unsigned long long)buffer->thread_id,
+                           (unsigned long long)(event.start_usec - trace_start_usec_steamaudio), (unsigned long long)event.duration_usec);
+            file->store_buffer((const uint8_t *)line, len);
+            first = false;
+        }
+    }
+    file->store_string("\n]}\n");
+    if (dropped) {
+        printf("Steam Audio trace dropped %u events, buffers hold %d per thread\n", dropped, TRACE_BUFFER_EVENTS_STEAMAUDIO);
+    }
+    uint32_t dropped_threads = trace_dropped_threads_steamaudio.load();
+    if (dropped_threads) {
+        printf("Steam Audio trace dropped %u threads, at most %d are traced\n", dropped_threads, TRACE_MAX_THREADS_STEAMAUDIO);
+    }
+    return OK;
+}
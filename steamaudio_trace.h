@@ -0,0 +1,71 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2023 saturnian-tides
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#ifndef STEAMAUDIO_TRACE_H
+#define STEAMAUDIO_TRACE_H
+
+#include "core/string/ustring.h"
+#include "core/typedefs.h"
+#include <atomic>
+
+#define TRACE_BUFFER_EVENTS_STEAMAUDIO 65536
+#define TRACE_MAX_THREADS_STEAMAUDIO 16
+
+//Complete ("X") span, name must be a string literal
+struct TraceEventSteamAudio {
+    const char * name;
+    uint64_t start_usec;
+    uint64_t duration_usec;
+};
+
+//Preallocated by start_trace_steamaudio(), claimed by one thread per session on its first span.
+//Written only by that thread, read by stop_trace_steamaudio() up to count
+struct TraceBufferSteamAudio {
+    uint64_t thread_id = 0;
+    const char * thread_name = nullptr;
+    std::atomic<uint32_t> count = 0;
+    std::atomic<uint32_t> dropped = 0;
+    TraceEventSteamAudio events[TRACE_BUFFER_EVENTS_STEAMAUDIO];
+};
+
+extern std::atomic<bool> trace_enabled_steamaudio;
+
+Error start_trace_steamaudio(const String& path);
+Error stop_trace_steamaudio();
+void release_trace_buffers_steamaudio();
+void trace_thread_name_steamaudio(const char * name);
+void record_trace_event_steamaudio(const char * name, uint64_t start_usec, uint64_t end_usec);
+
+struct TraceScopeSteamAudio {
+    const char * name;
+    uint64_t start_usec = 0;
+    bool active;
+    explicit TraceScopeSteamAudio(const char * p_name);
+    ~TraceScopeSteamAudio();
+};
+
+//Costs one relaxed load when no trace is running
+#define TRACE_SCOPE_STEAMAUDIO(name) TraceScopeSteamAudio trace_scope_steamaudio(name)
+
+#endif // STEAMAUDIO_TRACE_H